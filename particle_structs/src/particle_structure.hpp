@@ -48,6 +48,10 @@ namespace pumipic {
       MTV<N>* view = static_cast<MTV<N>*>(ptcl_data[N]);
       return Slice<N>(*view);
     }
+    /* Provides the views of every member for kernels over all member types
+         (see MemberTypeLibraries.h), the views are owned by the structure
+     */
+    MTVs getMemberViews() {return ptcl_data;}
 
 
     virtual void rebuild(kkLidView new_element, kkLidView new_particle_elements = kkLidView(),
@@ -18,6 +18,17 @@ namespace pumipic {
                                                        DestinationIndexForParticle);
 */
   template <typename PS, typename... Types> struct CopyPSToPS;
+/* PackParticlesToSend<ParticleStructure, Header, DataTypes> - packs particle info into the
+                                                                records of a send buffer
+     Usage: PackParticlesToSend<ParticleStructure, Header, MemberTypes>(ParticleStructure,
+                                                                        PackedBuffer,
+                                                                        SourceMemberTypeViews,
+                                                                        NewProcessPerParticle,
+                                                                        RecordIndexPerParticle,
+                                                                        OwningRank);
+     Note: The Header of each record is written by the caller
+*/
+  template <typename PS, typename Header, typename... Types> struct PackParticlesToSend;
 
 //Copy Particles To Send Templated Struct
   template <typename PS, typename... Types> struct CopyParticlesToSendImpl;
@@ -66,6 +77,62 @@ namespace pumipic {
     }
   };
 
+  //Pack Particles To Send Templated Struct
+  template <typename PS, std::size_t Stride, std::size_t Offset, typename... Types>
+  struct PackParticlesToSendImpl;
+  template <typename PS, std::size_t Stride, std::size_t Offset>
+  struct PackParticlesToSendImpl<PS, Stride, Offset> {
+    typedef typename PS::device_type Device;
+    PackParticlesToSendImpl(PS* ps, PackedBuffer<Device>, MemberTypeViewsConst,
+                            typename PS::kkLidView, typename PS::kkLidView, int) {}
+  };
+  template <typename PS, std::size_t Stride, std::size_t Offset, typename T, typename... Types>
+  struct PackParticlesToSendImpl<PS, Stride, Offset, T, Types...> {
+    typedef typename PS::device_type Device;
+    typedef typename BaseType<T>::type BT;
+    typedef PackedLayout<Offset, T, Types...> Layout;
+    PackParticlesToSendImpl(PS* ps, PackedBuffer<Device> buffer,
+                            MemberTypeViewsConst srcs,
+                            typename PS::kkLidView ps_to_array,
+                            typename PS::kkLidView array_indices, int rank) {
+      enclose(ps, buffer, srcs, ps_to_array, array_indices, rank);
+    }
+    void enclose(PS* ps, PackedBuffer<Device> buffer,
+                 MemberTypeViewsConst srcs,
+                 typename PS::kkLidView ps_to_array,
+                 typename PS::kkLidView array_indices, int rank) {
+      MemberTypeView<T, Device> src = *static_cast<MemberTypeView<T, Device> const*>(srcs[0]);
+      const std::size_t offset = Layout::offset;
+      const std::size_t stride = Stride;
+      auto packPSToBuffer = PS_LAMBDA(int elm_id, int ptcl_id, bool mask) {
+        if (mask && ps_to_array(ptcl_id) != rank) {
+          const std::size_t index = array_indices(ptcl_id);
+          BT* dst = reinterpret_cast<BT*>(buffer.data() + index * stride + offset);
+          CopyViewToBuffer<T, Device>(dst, src, ptcl_id);
+        }
+      };
+      parallel_for(ps, packPSToBuffer);
+      PackParticlesToSendImpl<PS, Stride, Layout::offset + sizeof(T), Types...>(ps, buffer,
+                                                                               srcs + 1,
+                                                                               ps_to_array,
+                                                                               array_indices,
+                                                                               rank);
+    }
+  };
+  template <typename PS, typename Header, typename... Types>
+  struct PackParticlesToSend<PS, Header, MemberTypes<Types...> > {
+    typedef typename PS::device_type Device;
+    typedef PackedParticle<Header, MemberTypes<Types...> > Packed;
+    PackParticlesToSend(PS* ps, PackedBuffer<Device> buffer,
+                        MemberTypeViewsConst srcs,
+                        typename PS::kkLidView ps_to_array,
+                        typename PS::kkLidView array_indices, int rank) {
+      PackParticlesToSendImpl<PS, Packed::bytes, sizeof(Header), Types...>(ps, buffer, srcs,
+                                                                           ps_to_array,
+                                                                           array_indices, rank);
+    }
+  };
+
   template <typename PS, typename... Types> struct CopyPSToPSImpl;
   template <typename PS> struct CopyPSToPSImpl<PS> {
     typedef typename PS::device_type Device;
@@ -4,7 +4,7 @@ namespace pumipic {
   int SellCSigma<DataTypes, MemSpace>::chooseChunkHeight(int maxC,
                                                          kkLidView ptcls_per_elem) {
     lid_t num_elems_with_ptcls = 0;
-    Kokkos::parallel_reduce("count_elems", ptcls_per_elem.size(),
+    Kokkos::parallel_reduce("count_elems", RangePolicyType(space(), 0, ptcls_per_elem.size()),
                             KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
       sum += ptcls_per_elem(i) > 0;
     }, num_elems_with_ptcls);
@@ -21,26 +21,28 @@ namespace pumipic {
                                                           kkLidView& chunk_widths,
                                                           kkLidView& row_element,
                                                           kkLidView& element_row) {
+    const execution_space exec = space();
     nchunks = num_elems / C_ + (num_elems % C_ != 0);
     chunk_widths = kkLidView("chunk_widths", nchunks);
     row_element = kkLidView("row_element", nchunks * C_);
     element_row = kkLidView("element_row", nchunks * C_);
+    //The count stays on the device until printMetrics requests it
     kkLidView empty("empty_elems", 1);
-    Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t element = ptcls(i).second;
         row_element(i) = element;
         element_row(element) = i;
         Kokkos::atomic_fetch_add(&empty[0], ptcls(i).first == 0);
       });
-    Kokkos::parallel_for(Kokkos::RangePolicy<>(num_elems, nchunks * C_),
+    Kokkos::parallel_for(RangePolicyType(exec, num_elems, nchunks * C_),
                          KOKKOS_LAMBDA(const lid_t& i) {
                            row_element(i) = i;
                            element_row(i) = i;
                            Kokkos::atomic_fetch_add(&empty[0], 1);
                          });
 
-    num_empty_elements = getLastValue<lid_t>(empty);
-    const PolicyType policy(nchunks, C_);
+    num_empty_elements = empty;
+    const PolicyType policy(exec, nchunks, C_);
     lid_t C_local = C_;
     lid_t num_elems_local = num_elems;
     Kokkos::parallel_for(policy, KOKKOS_LAMBDA(const typename PolicyType::member_type& thread) {
@@ -58,15 +60,15 @@ namespace pumipic {
     if (shuffle_padding > 0) {
       lid_t cw_sum, cw_sum_count;
       double cw_sum_inv;
-      Kokkos::parallel_reduce("sum_chunk_widths", nchunks,
+      Kokkos::parallel_reduce("sum_chunk_widths", RangePolicyType(exec, 0, nchunks),
                               KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
         sum += chunk_widths[i];
       }, cw_sum);
-      Kokkos::parallel_reduce("sum_chunk_widths", nchunks,
+      Kokkos::parallel_reduce("sum_chunk_widths", RangePolicyType(exec, 0, nchunks),
                               KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
         sum += chunk_widths[i] > 0;
       }, cw_sum_count);
-      Kokkos::parallel_reduce("sum_chunk_widths", nchunks,
+      Kokkos::parallel_reduce("sum_chunk_widths", RangePolicyType(exec, 0, nchunks),
                               KOKKOS_LAMBDA(const lid_t& i, double& sum) {
         if (chunk_widths[i] > 0)
           sum += 1.0/ chunk_widths[i];
@@ -76,16 +78,16 @@ namespace pumipic {
         const lid_t avg_pad = cw_sum * shuffle_padding / cw_sum_count;
         const double local_padding = shuffle_padding;
         if (pad_strat == PAD_EVENLY)
-          Kokkos::parallel_for(nchunks, KOKKOS_LAMBDA(const lid_t& i) {
+          Kokkos::parallel_for(RangePolicyType(exec, 0, nchunks), KOKKOS_LAMBDA(const lid_t& i) {
               if (chunk_widths[i] > 0)
                 chunk_widths[i] += avg_pad;
             });
         else if (pad_strat == PAD_PROPORTIONALLY)
-          Kokkos::parallel_for(nchunks, KOKKOS_LAMBDA(const lid_t& i) {
+          Kokkos::parallel_for(RangePolicyType(exec, 0, nchunks), KOKKOS_LAMBDA(const lid_t& i) {
               chunk_widths[i] += chunk_widths[i] * local_padding;
             });
         else if (pad_strat == PAD_INVERSELY)
-          Kokkos::parallel_for(nchunks, KOKKOS_LAMBDA(const lid_t& i) {
+          Kokkos::parallel_for(RangePolicyType(exec, 0, nchunks), KOKKOS_LAMBDA(const lid_t& i) {
               if (chunk_widths[i] != 0)
                 chunk_widths[i] += cw_sum2 / chunk_widths[i];
             });
@@ -96,13 +98,14 @@ namespace pumipic {
   template<class DataTypes, typename MemSpace>
     void SellCSigma<DataTypes, MemSpace>::createGlobalMapping(kkGidView elmGid,kkGidView& elm2Gid,
                                                               GID_Mapping& elmGid2Lid) {
+    const execution_space exec = space();
     elm2Gid = kkGidView("row to element gid", numRows());
-    Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
-        const gid_t gid = elmGid(i);
-        elm2Gid(i) = gid;
-        elmGid2Lid.insert(gid, i);
+    Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
+        elm2Gid(i) = elmGid(i);
       });
-    Kokkos::parallel_for(Kokkos::RangePolicy<>(num_elems, numRows()), KOKKOS_LAMBDA(const lid_t& i) {
+    //Element gids are fixed after construction so a static sorted index is used
+    elmGid2Lid.build(elmGid, num_elems, exec);
+    Kokkos::parallel_for(RangePolicyType(exec, num_elems, numRows()), KOKKOS_LAMBDA(const lid_t& i) {
         elm2Gid(i) = -1;
       });
   }
@@ -112,9 +115,10 @@ namespace pumipic {
                                                            kkLidView chunk_widths,
                                                            kkLidView& offs,
                                                            kkLidView& s2c, lid_t& cap) {
+    const execution_space exec = space();
     kkLidView slices_per_chunk("slices_per_chunk", nChunks + 1);
     const lid_t V_local = V_;
-    Kokkos::parallel_for(nChunks, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, nChunks), KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t width = chunk_widths(i);
         const lid_t val1 = width / V_local;
         const lid_t val2 = width % V_local;
@@ -122,15 +126,16 @@ namespace pumipic {
         slices_per_chunk(i) = val1 + val3;
       });
     kkLidView offset_nslices("offset_nslices",nChunks+1);
-    exclusive_scan(slices_per_chunk, offset_nslices);
+    exclusive_scan(slices_per_chunk, offset_nslices, exec);
 
-    nSlices = getLastValue<lid_t>(offset_nslices);
+    //The number of slices sizes the allocations below so it must come back to the host
+    nSlices = getLastValue<lid_t>(offset_nslices, exec);
     offs = kkLidView("SCS offset", nSlices + 1);
     s2c = kkLidView("slice to chunk", nSlices);
     kkLidView slice_size("slice_size", nSlices + 1);
     const lid_t nat_size = V_*C_;
     const lid_t C_local = C_;
-    Kokkos::parallel_for(nChunks, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, nChunks), KOKKOS_LAMBDA(const lid_t& i) {
       const lid_t start = offset_nslices(i);
       const lid_t end = offset_nslices(i+1);
       for (lid_t j = start; j < end; ++j) {
@@ -143,23 +148,24 @@ namespace pumipic {
       }
     });
 
-    exclusive_scan(slice_size, offs);
-    cap = getLastValue<lid_t>(offs);
+    exclusive_scan(slice_size, offs, exec);
+    cap = getLastValue<lid_t>(offs, exec);
   }
   template<class DataTypes, typename MemSpace>
   void SellCSigma<DataTypes, MemSpace>::setupParticleMask(kkLidView mask,
                                                           PairView ptcls,
                                                           kkLidView chunk_widths,
                                                           kkLidView& chunk_starts) {
+    const execution_space exec = space();
     //Get start of each chunk
     auto offsets_cpy = offsets;
     auto slice_to_chunk_cpy = slice_to_chunk;
     chunk_starts = kkLidView("chunk_starts", num_chunks);
     lid_t cap_local = capacity_;
-    Kokkos::parallel_for(Kokkos::RangePolicy<>(1,num_chunks), KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 1, num_chunks), KOKKOS_LAMBDA(const lid_t& i) {
       chunk_starts[i] = cap_local;
     });
-    Kokkos::parallel_for(num_slices-1, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, num_slices-1), KOKKOS_LAMBDA(const lid_t& i) {
       const lid_t my_chunk = slice_to_chunk_cpy(i);
       const lid_t next_chunk = slice_to_chunk_cpy(i+1);
       if (my_chunk != next_chunk) {
@@ -172,7 +178,7 @@ namespace pumipic {
     const lid_t league_size = num_chunks;
     const lid_t team_size = C_;
     const lid_t ne = num_elems;
-    const PolicyType policy(league_size, team_size);
+    const PolicyType policy(exec, league_size, team_size);
     auto row_to_element_cpy = row_to_element;
     Kokkos::parallel_for(policy, KOKKOS_LAMBDA(const typename PolicyType::member_type& thread) {
       const lid_t chunk = thread.league_rank();
@@ -195,6 +201,7 @@ namespace pumipic {
   void SellCSigma<DataTypes, MemSpace>::initSCSData(kkLidView chunk_starts,
                                                     kkLidView particle_elements,
                                                     MTVs particle_info) {
+    const execution_space exec = space();
     lid_t given_particles = particle_elements.size();
     assert(given_particles == num_ptcls);
     kkLidView element_to_row_local = element_to_row;
@@ -203,19 +210,19 @@ namespace pumipic {
     kkLidView row_starts("row_starts", numRows());
     kkLidView row_index("row_index", numRows());
     kkLidView row_ends("row_ends", numRows());
-    Kokkos::parallel_for(numRows(), KOKKOS_LAMBDA(const int& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, numRows()), KOKKOS_LAMBDA(const int& i) {
       int chunk = i / C_local;
       int row_of_chunk = i % C_local;
       row_index(i) = chunk_starts(chunk) + row_of_chunk;
     });
 
     kkLidView particle_indices("new_particle_scs_indices", given_particles);
-    Kokkos::parallel_for(given_particles, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, given_particles), KOKKOS_LAMBDA(const lid_t& i) {
       lid_t new_elem = particle_elements(i);
       lid_t new_row = element_to_row_local(new_elem);
       particle_indices(i) = Kokkos::atomic_fetch_add(&row_index(new_row), C_local);
     });
 
-    CopyViewsToViews<kkLidView, DataTypes>(ptcl_data, particle_info, particle_indices);
+    CopyViewsToViews<kkLidView, DataTypes>(ptcl_data, particle_info, particle_indices, exec);
   }
 }
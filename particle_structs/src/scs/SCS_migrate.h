@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #include <psMemberType.h>
 namespace pumipic {
 
@@ -21,101 +22,197 @@ namespace pumipic {
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    //Statistics are gathered per neighbor and per phase for the caller
+    MigrationStats& stats = dist.stats();
+    stats.reset(comm_size);
+    Kokkos::Timer phase_timer;
+
+    //Records for ranks on the same node are read directly from the sender's shared window,
+    // kernels write the window so the structure must be in host memory
+    const bool node_aware = dist.isNodeAware() &&
+      std::is_same<memory_space, Kokkos::HostSpace>::value;
+    //Growing the window is collective on the node so every rank agrees on the largest size,
+    // at most every particle is sent. The reduction overlaps the counting and the window is
+    // reserved on every path, including the early exits.
+    unsigned long local_window_bytes =
+      num_ptcls * PackedParticle<MigrationHeader, DataTypes>::bytes;
+    unsigned long window_bytes = 0;
+    MPI_Request window_request = MPI_REQUEST_NULL;
+    if (node_aware)
+      MPI_Iallreduce(&local_window_bytes, &window_bytes, 1, MPI_UNSIGNED_LONG, MPI_MAX,
+                     dist.nodeComm(), &window_request);
+    NodeWindow* window = NULL;
+    auto reserveWindow = [&]() {
+      if (!node_aware)
+        return;
+      MPI_Wait(&window_request, MPI_STATUS_IGNORE);
+      window = &dist.reserveNodeWindow(window_bytes);
+    };
+
     //If serial, skip migration
     if (comm_size == 1) {
+      reserveWindow();
+      phase_timer.reset();
       rebuild(new_element, new_particle_elements, new_particle_info);
+      stats.rebuild_seconds = phase_timer.seconds();
+      stats.num_ptcls = num_ptcls;
+      stats.total_seconds = timer.seconds();
       if(!world_rank || world_rank == world_size/2)
         fprintf(stderr, "%d ps particle migration (seconds) %f\n", world_rank, timer.seconds());
       Kokkos::Profiling::popRegion();
       return;
     }
 
-    //Count number of particles to send to each process
-    kkLidView num_send_particles("num_send_particles", comm_size + 1);
+    const execution_space exec = space();
+    //Particles for ranks outside of the neighborhood are sent towards them through neighbors
+    const int max_rounds = dist.maxHops();
+    const bool forward = max_rounds > 1;
+    //Kernels read the ranks through the lookups, the distributor stays on the host
+    const DistributorLookup<MemSpace> lookup = dist.lookup();
+    //Counts and offsets per process are slices of one persistent array followed by the
+    // largest number of hops of a sent particle and the number of particles that can not
+    // be sent
+    const lid_t ncounts = comm_size + 1;
+    reserveMigrateView(migrate_counts, 4 * ncounts + 2, "migrate_counts");
+    reserveMigrateView(migrate_counts_host, 4 * ncounts + 2, "migrate_counts_host");
+    Kokkos::deep_copy(exec, migrate_counts, 0);
+    auto num_send_particles = Kokkos::subview(migrate_counts, std::make_pair(0, ncounts));
+    auto num_recv_particles = Kokkos::subview(migrate_counts,
+                                              std::make_pair(ncounts, 2 * ncounts));
+    auto offset_send_particles = Kokkos::subview(migrate_counts,
+                                                 std::make_pair(2 * ncounts, 3 * ncounts));
+    auto offset_recv_particles = Kokkos::subview(migrate_counts,
+                                                 std::make_pair(3 * ncounts, 4 * ncounts));
+    auto offset_send_particles_host = Kokkos::subview(migrate_counts_host,
+                                                      std::make_pair(2 * ncounts, 3 * ncounts));
+    auto offset_recv_particles_host = Kokkos::subview(migrate_counts_host,
+                                                      std::make_pair(3 * ncounts, 4 * ncounts));
+    auto max_hops = Kokkos::subview(migrate_counts, std::make_pair(4 * ncounts, 4 * ncounts + 1));
+    auto max_hops_host = Kokkos::subview(migrate_counts_host,
+                                         std::make_pair(4 * ncounts, 4 * ncounts + 1));
+    auto num_unreachable = Kokkos::subview(migrate_counts,
+                                           std::make_pair(4 * ncounts + 1, 4 * ncounts + 2));
+    auto num_unreachable_host = Kokkos::subview(migrate_counts_host,
+                                                std::make_pair(4 * ncounts + 1, 4 * ncounts + 2));
+
+    //Count number of particles to send to each process (or to the next hop towards it)
     auto count_sending_particles = PS_LAMBDA(lid_t element_id, lid_t particle_id, bool mask) {
       const lid_t process = new_process(particle_id);
-      const lid_t process_index = dist.index(process);
-      Kokkos::atomic_fetch_add(&(num_send_particles(process_index)),
-                               mask * (process != comm_rank));
+      if (!mask || process == comm_rank)
+        return;
+      const lid_t process_index = forward ? lookup.route(process) : lookup.index(process);
+      //Particles for ranks the distributor can not reach stay on this process
+      if (process_index < 0) {
+        new_process(particle_id) = comm_rank;
+        Kokkos::atomic_fetch_add(&(num_unreachable(0)), 1);
+        return;
+      }
+      Kokkos::atomic_fetch_add(&(num_send_particles(process_index)), 1);
+      if (forward && lookup.hops(process) > 1)
+        Kokkos::atomic_fetch_max(&(max_hops(0)), lookup.hops(process));
     };
     parallel_for(count_sending_particles);
+    //The counts are handed to MPI directly so they must be complete
+    exec.fence();
 
     /********* Send # of particles being sent to each process *********/
-    kkLidView num_recv_particles("num_recv_particles", comm_size + 1);
-    int num_send_ranks = dist.isWorld() ? 0 : comm_size - 1;
-    MPI_Request* count_send_requests = NULL;
-    if (num_send_ranks > 0)
-      count_send_requests = new MPI_Request[num_send_ranks];
-    int num_recv_ranks = dist.isWorld() ? 1 : comm_size - 1;
+    //A neighborhood distributor only exchanges counts with its neighbors
+    int num_recv_ranks = 1;
     MPI_Request* count_recv_requests = new MPI_Request[num_recv_ranks];
     if (dist.isWorld())
       PS_Comm_Ialltoall(num_send_particles, 1, num_recv_particles, 1,
                         dist.mpi_comm(), count_recv_requests);
-    else {
-      int request_index = 0;
-      for (int i = 0; i < comm_size; ++i) {
-        int rank = dist.rank_host(i);
-        if (rank != comm_rank) {
-          PS_Comm_Isend(num_send_particles, i, 1, rank, 0, dist.mpi_comm(),
-                        count_send_requests + request_index);
-          PS_Comm_Irecv(num_recv_particles, i, 1, rank, 0, dist.mpi_comm(),
-                        count_recv_requests + request_index);
-          ++request_index;
-        }
-      }
-    }
+    else
+      PS_Comm_Ineighbor_alltoall(num_send_particles, 1, num_recv_particles, 1,
+                                 dist.neighbor_comm(), count_recv_requests);
 
     //Gather sending particle data
     //Perform an ex-sum on num_send_particles & num_recv_particles
-    kkLidView offset_send_particles("offset_send_particles", comm_size+1);
-    kkLidView offset_send_particles_temp("offset_send_particles_temp", comm_size + 1);
-    exclusive_scan(num_send_particles, offset_send_particles);
-    Kokkos::deep_copy(offset_send_particles_temp, offset_send_particles);
-    kkLidHostMirror offset_send_particles_host = deviceToHost(offset_send_particles);
+    exclusive_scan(num_send_particles, offset_send_particles, exec);
+    Kokkos::deep_copy(exec, offset_send_particles_host, offset_send_particles);
+    Kokkos::deep_copy(exec, max_hops_host, max_hops);
+    Kokkos::deep_copy(exec, num_unreachable_host, num_unreachable);
+    exec.fence();
+    if (num_unreachable_host(0) > 0)
+      fprintf(stderr, "[ERROR] %d particles on rank %d are sent to ranks the distributor can "
+              "not reach and stay on this rank\n", num_unreachable_host(0), comm_rank);
 
-    //Create arrays for particles being sent
+    //Every rank takes part in the same number of forwarding rounds
+    int local_rounds = max_hops_host(0), rounds = 1;
+    MPI_Request rounds_request = MPI_REQUEST_NULL;
+    if (forward)
+      MPI_Iallreduce(&local_rounds, &rounds, 1, MPI_INT, MPI_MAX, dist.mpi_comm(),
+                     &rounds_request);
+
+    //Each particle is sent as one record holding its element gid and destination process
+    // followed by its members
+    typedef PackedParticle<MigrationHeader, DataTypes> Packed;
+    const std::size_t ptcl_bytes = Packed::bytes;
+
+    //Reserve the packed buffer for particles being sent, records are grouped by destination
     lid_t np_send = offset_send_particles_host(comm_size);
-    kkLidView send_element("send_element", np_send);
-    MTVs send_particle;
-    //Allocate views for each data type into send_particle[type]
-    CreateViews<device_type, DataTypes>(send_particle, np_send);
-    kkLidView send_index("send_particle_index", capacity());
+    PackedBuffer<device_type> send_buffer;
+    reserveWindow();
+    if (node_aware)
+      send_buffer = PackedBuffer<device_type>(window->data, window->size);
+    else {
+      reserveMigrateView(migrate_send_buffer, np_send * ptcl_bytes, "migrate_send_buffer");
+      send_buffer = migrate_send_buffer;
+    }
+    reserveMigrateView(migrate_send_index, capacity(), "migrate_send_index");
+    kkLidView send_index = migrate_send_index;
+    //The send offsets are consumed as the records are placed
+    auto offset_send_particles_temp = offset_send_particles;
     auto element_to_gid_local = element_to_gid;
+    Kokkos::Timer pack_timer;
     auto gatherParticlesToSend = PS_LAMBDA(lid_t element_id, lid_t particle_id, lid_t mask) {
       const lid_t process = new_process(particle_id);
-      const lid_t process_index = dist.index(process);
       if (mask && process != comm_rank) {
+        const lid_t process_index = forward ? lookup.route(process) : lookup.index(process);
         send_index(particle_id) =
           Kokkos::atomic_fetch_add(&(offset_send_particles_temp(process_index)),1);
-        const lid_t index = send_index(particle_id);
-        send_element(index) = element_to_gid_local(new_element(particle_id));
+        const std::size_t index = send_index(particle_id);
+        MigrationHeader* header =
+          reinterpret_cast<MigrationHeader*>(send_buffer.data() + index * ptcl_bytes);
+        header->gid = element_to_gid_local(new_element(particle_id));
+        header->dest = process;
       }
     };
     parallel_for(gatherParticlesToSend);
-    //Copy the values from ptcl_data[type][particle_id] into send_particle[type](index) for each data type
-    CopyParticlesToSend<SellCSigma<DataTypes, MemSpace>, DataTypes>(this, send_particle,
-                                                                    ptcl_data,
-                                                                    new_process,
-                                                                    send_index);
+    //Pack the values from ptcl_data[type][particle_id] into record send_index(particle_id)
+    PackParticlesToSend<SellCSigma<DataTypes, MemSpace>, MigrationHeader,
+                        DataTypes>(this, send_buffer, ptcl_data, new_process, send_index,
+                                   comm_rank);
 
     //Wait until all counts are received
+    phase_timer.reset();
     PS_Comm_Waitall<device_type>(num_recv_ranks, count_recv_requests, MPI_STATUSES_IGNORE);
     delete [] count_recv_requests;
+    if (forward) {
+      MPI_Wait(&rounds_request, MPI_STATUS_IGNORE);
+      rounds = std::min(std::max(rounds, 1), max_rounds);
+    }
+    stats.count_seconds = phase_timer.seconds();
+    stats.rounds = rounds;
 
     //Count the number of processes being sent to and recv from
     lid_t num_sending_to = 0, num_receiving_from = 0;
-    Kokkos::parallel_reduce("sum_senders", comm_size,
+    Kokkos::parallel_reduce("sum_senders", RangePolicyType(exec, 0, comm_size),
                             KOKKOS_LAMBDA (const lid_t& i, lid_t& lsum ) {
       lsum += (num_send_particles(i) > 0);
     }, num_sending_to);
-    Kokkos::parallel_reduce("sum_receivers", comm_size,
+    Kokkos::parallel_reduce("sum_receivers", RangePolicyType(exec, 0, comm_size),
                             KOKKOS_LAMBDA (const lid_t& i, lid_t& lsum ) {
       lsum += (num_recv_particles(i) > 0);
     }, num_receiving_from);
 
-    //If no particles are being sent or received, perform rebuild
-    if (num_sending_to == 0 && num_receiving_from == 0) {
+    //If no particles are being sent, received or forwarded, perform rebuild
+    if (num_sending_to == 0 && num_receiving_from == 0 && rounds == 1) {
+      phase_timer.reset();
       rebuild(new_element, new_particle_elements, new_particle_info);
+      stats.rebuild_seconds = phase_timer.seconds();
+      stats.num_ptcls = num_ptcls;
+      stats.total_seconds = timer.seconds();
       if(!world_rank || world_rank == world_size/2)
         fprintf(stderr, "%d ps particle migration (seconds) %f\n", world_rank, timer.seconds());
       Kokkos::Profiling::popRegion();
@@ -123,70 +220,166 @@ namespace pumipic {
     }
 
     //Offset the recv particles
-    kkLidView offset_recv_particles("offset_recv_particles", comm_size+1);
-    exclusive_scan(num_recv_particles, offset_recv_particles);
-    kkLidHostMirror offset_recv_particles_host = deviceToHost(offset_recv_particles);
+    exclusive_scan(num_recv_particles, offset_recv_particles, exec);
+    Kokkos::deep_copy(exec, offset_recv_particles_host, offset_recv_particles);
+    //Also completes the gather of the send buffers before they are handed to MPI
+    exec.fence();
+    stats.pack_seconds = pack_timer.seconds() - stats.count_seconds;
     int np_recv = offset_recv_particles_host(comm_size);
 
-    //wait for send requests if there are any
-    if (count_send_requests) {
-      PS_Comm_Waitall<device_type>(num_send_ranks, count_send_requests, MPI_STATUSES_IGNORE);
-      delete [] count_send_requests;
-    }
+    //Reserve the packed buffer for particles being received
+    reserveMigrateView(migrate_recv_buffer, np_recv * ptcl_bytes, "migrate_recv_buffer");
+    PackedBuffer<device_type> recv_buffer = migrate_recv_buffer;
 
-    //Create arrays for particles being received
-    lid_t new_ptcls = new_particle_elements.size();
-    kkLidView recv_element("recv_element", np_recv + new_ptcls);
-    MTVs recv_particle;
-    //Allocate views for each data type into recv_particle[type]
-    CreateViews<device_type, DataTypes>(recv_particle, np_recv + new_ptcls);
+    //Messages that are not forwarded or read from the window may encode their records,
+    // message i starts at record offset i in the encoded buffers
+    MigrationCodec& codec = dist.codec();
+    const bool encoded = rounds == 1 && !codec.isRaw();
+    const std::size_t encoded_bytes =
+      encoded ? codec.maxRecordBytes<device_type, MigrationHeader, DataTypes>() : ptcl_bytes;
+    PackedBuffer<device_type> encode_buffer, decode_buffer;
+    //Bytes of the encoded message sent to and received from each process
+    std::vector<int> send_message_bytes(comm_size, 0), recv_message_bytes(comm_size, 0);
+    if (encoded) {
+      phase_timer.reset();
+      reserveMigrateView(migrate_encode_buffer, np_send * encoded_bytes, "migrate_encode_buffer");
+      reserveMigrateView(migrate_decode_buffer, np_recv * encoded_bytes, "migrate_decode_buffer");
+      reserveMigrateView(migrate_encoded_counts, comm_size, "migrate_encoded_counts");
+      reserveMigrateView(migrate_encoded_counts_host, comm_size, "migrate_encoded_counts_host");
+      encode_buffer = migrate_encode_buffer;
+      decode_buffer = migrate_decode_buffer;
+      codec.encode<device_type, MigrationHeader, DataTypes>(send_buffer, encode_buffer,
+                                                            offset_send_particles_host.data(),
+                                                            comm_size, migrate_encoded_counts,
+                                                            migrate_encoded_counts_host, exec);
+      for (lid_t i = 0; i < comm_size; ++i)
+        send_message_bytes[i] = migrate_encoded_counts_host(i);
+      const std::size_t record_bytes =
+        codec.recordBytes<device_type, MigrationHeader, DataTypes>();
+      for (lid_t i = 0; i < comm_size; ++i)
+        recv_message_bytes[i] =
+          (offset_recv_particles_host(i+1) - offset_recv_particles_host(i)) * record_bytes;
+      //Messages with XOR_CODEC members depend on their values so each encoded message is
+      // preceded by its size, ranks that skipped to the rebuild take no part
+      if (codec.isVariable()) {
+        std::vector<MPI_Request> size_requests;
+        for (lid_t i = 0; i < comm_size; ++i) {
+          const int rank = dist.rank_host(i);
+          if (rank == comm_rank || (node_aware && dist.nodeRank(rank) >= 0))
+            continue;
+          if (offset_send_particles_host(i+1) > offset_send_particles_host(i)) {
+            size_requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(&(send_message_bytes[i]), 1, MPI_INT, rank, 4, dist.mpi_comm(),
+                      &size_requests.back());
+          }
+          if (offset_recv_particles_host(i+1) > offset_recv_particles_host(i)) {
+            size_requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(&(recv_message_bytes[i]), 1, MPI_INT, rank, 4, dist.mpi_comm(),
+                      &size_requests.back());
+          }
+        }
+        MPI_Waitall(size_requests.size(), size_requests.data(), MPI_STATUSES_IGNORE);
+      }
+      stats.pack_seconds += phase_timer.seconds();
+    }
 
-    //Get pointers to the data for MPI calls
+    //One message per neighbor in each direction, on-node neighbors instead exchange the
+    // start of the records in the window and a message once they have been copied
     lid_t send_num = 0, recv_num = 0;
-    lid_t num_sends = num_sending_to * (num_types + 1);
-    lid_t num_recvs = num_receiving_from * (num_types + 1);
-    MPI_Request* send_requests = new MPI_Request[num_sends];
+    //First record and number of records of each receive
+    std::vector<lid_t> recv_starts(num_receiving_from), recv_sizes(num_receiving_from);
+    //Sender, its rank on the node (-1 if off node) and its first record in its window
+    std::vector<int> recv_ranks(num_receiving_from), recv_node_ranks(num_receiving_from, -1);
+    std::vector<lid_t> window_starts(num_receiving_from);
+    lid_t num_sends = num_sending_to;
+    lid_t num_recvs = num_receiving_from;
+    MPI_Request* send_requests = new MPI_Request[2 * num_sends];
     MPI_Request* recv_requests = new MPI_Request[num_recvs];
+    //The packed records must be visible to the other ranks of the node before they are told
+    if (node_aware)
+      MPI_Win_sync(window->win);
     //Send the particles to each neighbor
     for (lid_t i = 0; i < comm_size; ++i) {
       int rank = dist.rank_host(i);
       if (rank == comm_rank)
         continue;
+      const int node_rank = node_aware ? dist.nodeRank(rank) : -1;
 
       //Sending
       lid_t num_send = offset_send_particles_host(i+1) - offset_send_particles_host(i);
       if (num_send > 0) {
         lid_t start_index = offset_send_particles_host(i);
-        PS_Comm_Isend(send_element, start_index, num_send, rank, 0, dist.mpi_comm(),
-                      send_requests +send_num);
-        send_num++;
-        SendViews<device_type, DataTypes>(send_particle, start_index, num_send, rank, 1,
-                                          dist.mpi_comm(), send_requests + send_num);
-        send_num+=num_types;
+        stats.ptcls_sent[i] = num_send;
+        stats.bytes_sent[i] = node_rank < 0 && encoded ? send_message_bytes[i] :
+          static_cast<double>(num_send) * ptcl_bytes;
+        stats.messages_sent++;
+        if (node_rank >= 0) {
+          //The window is not reused until the neighbor has copied its records
+          MPI_Isend(&(offset_send_particles_host(i)), 1, MPI_INT, rank, 2, dist.mpi_comm(),
+                    send_requests + send_num);
+          MPI_Irecv(NULL, 0, MPI_CHAR, rank, 3, dist.mpi_comm(), send_requests + send_num + 1);
+          send_num += 2;
+        }
+        else if (encoded) {
+          PS_Comm_Isend(encode_buffer, start_index * encoded_bytes, send_message_bytes[i],
+                        rank, 0, dist.mpi_comm(), send_requests + send_num);
+          send_num++;
+        }
+        else {
+          PS_Comm_Isend(send_buffer, start_index * ptcl_bytes, num_send * ptcl_bytes, rank, 0,
+                        dist.mpi_comm(), send_requests + send_num);
+          send_num++;
+        }
       }
       //Receiving
       lid_t num_recv = offset_recv_particles_host(i+1) - offset_recv_particles_host(i);
       if (num_recv > 0) {
         lid_t start_index = offset_recv_particles_host(i);
-        PS_Comm_Irecv(recv_element, start_index, num_recv, rank, 0, dist.mpi_comm(),
-                      recv_requests + recv_num);
+        stats.ptcls_recv[i] = num_recv;
+        stats.bytes_recv[i] = node_rank < 0 && encoded ? recv_message_bytes[i] :
+          static_cast<double>(num_recv) * ptcl_bytes;
+        stats.messages_recv++;
+        if (node_rank >= 0)
+          MPI_Irecv(&(window_starts[recv_num]), 1, MPI_INT, rank, 2, dist.mpi_comm(),
+                    recv_requests + recv_num);
+        else if (encoded)
+          PS_Comm_Irecv(decode_buffer, start_index * encoded_bytes, recv_message_bytes[i],
+                        rank, 0, dist.mpi_comm(), recv_requests + recv_num);
+        else
+          PS_Comm_Irecv(recv_buffer, start_index * ptcl_bytes, num_recv * ptcl_bytes, rank, 0,
+                        dist.mpi_comm(), recv_requests + recv_num);
+        recv_starts[recv_num] = start_index;
+        recv_sizes[recv_num] = num_recv;
+        recv_ranks[recv_num] = rank;
+        recv_node_ranks[recv_num] = node_rank;
         recv_num++;
-        RecvViews<device_type, DataTypes>(recv_particle,start_index, num_recv, rank, 1,
-                                          dist.mpi_comm(), recv_requests + recv_num);
-        recv_num+=num_types;
       }
     }
 
-    PS_Comm_Waitall<device_type>(num_recvs, recv_requests, MPI_STATUSES_IGNORE);
-    delete [] recv_requests;
-
-    /********** Convert the received element from element gid to element lid *********/
-    auto element_gid_to_lid_local = element_gid_to_lid;
-    Kokkos::parallel_for(np_recv, KOKKOS_LAMBDA(const lid_t& i) {
-        const gid_t gid = recv_element(i);
-        const lid_t index = element_gid_to_lid_local.find(gid);
-        recv_element(i) = element_gid_to_lid_local.value_at(index);
-      });
+    //Copies the records of an on-node receive out of the sender's window and releases them
+    // or decodes the records of an encoded receive
+    std::vector<MPI_Request> done_requests;
+    done_requests.reserve(num_recvs);
+    auto completeReceive = [&](lid_t index) {
+      if (recv_node_ranks[index] < 0) {
+        if (encoded)
+          codec.decode<device_type, MigrationHeader, DataTypes>(decode_buffer, recv_buffer,
+                                                                recv_starts[index],
+                                                                recv_sizes[index], exec);
+        return;
+      }
+      MPI_Win_sync(window->win);
+      MPI_Aint peer_size;
+      int disp_unit;
+      char* peer_data;
+      MPI_Win_shared_query(window->win, recv_node_ranks[index], &peer_size, &disp_unit,
+                           &peer_data);
+      std::memcpy(recv_buffer.data() + static_cast<std::size_t>(recv_starts[index]) * ptcl_bytes,
+                  peer_data + static_cast<std::size_t>(window_starts[index]) * ptcl_bytes,
+                  recv_sizes[index] * ptcl_bytes);
+      done_requests.push_back(MPI_REQUEST_NULL);
+      MPI_Isend(NULL, 0, MPI_CHAR, recv_ranks[index], 3, dist.mpi_comm(), &done_requests.back());
+    };
 
     /********** Set particles that were sent to non existent on this process *********/
     auto removeSentParticles = PS_LAMBDA(lid_t element_id, lid_t particle_id, lid_t mask) {
@@ -197,23 +390,72 @@ namespace pumipic {
     };
     parallel_for(removeSentParticles);
 
+    /********** Forward the records that have not reached their process *********/
+    //Forwarding rounds are in lockstep over all ranks so the first hop must complete first
+    if (rounds > 1) {
+      phase_timer.reset();
+      PS_Comm_Waitall<device_type>(num_recvs, recv_requests, MPI_STATUSES_IGNORE);
+      for (lid_t i = 0; i < num_recvs; ++i)
+        completeReceive(i);
+      np_recv = forwardMigrateRecords(dist, np_recv, rounds);
+      recv_buffer = migrate_recv_buffer;
+      stats.wait_seconds += phase_timer.seconds();
+    }
+
+    //Reserve the arrays for particles being received
+    lid_t new_ptcls = new_particle_elements.size();
+    const lid_t np_total = np_recv + new_ptcls;
+    reserveMigrateView(migrate_recv_element, np_total, "migrate_recv_element");
+    reserveMigrateView(migrate_new_index, new_ptcls, "migrate_new_index");
+    if (migrate_recv_size < np_total) {
+      if (migrate_recv_particle != NULL)
+        destroyViews<DataTypes, memory_space>(migrate_recv_particle);
+      migrate_recv_size = np_total * 1.1;
+      CreateViews<device_type, DataTypes>(migrate_recv_particle, migrate_recv_size);
+    }
+    //Rebuild takes the number of new particles from the size of the element view
+    kkLidView recv_element = Kokkos::subview(migrate_recv_element, std::make_pair(0, np_total));
+    MTVs recv_particle = migrate_recv_particle;
+
     /********** Add new particles to the migrated particles *********/
-    kkLidView new_ptcl_map("new_ptcl_map", new_ptcls);
-    Kokkos::parallel_for(new_ptcls, KOKKOS_LAMBDA(const lid_t& i) {
+    kkLidView new_ptcl_map = Kokkos::subview(migrate_new_index, std::make_pair(0, new_ptcls));
+    Kokkos::parallel_for(RangePolicyType(exec, 0, new_ptcls), KOKKOS_LAMBDA(const lid_t& i) {
         recv_element(np_recv + i) = new_particle_elements(i);
         new_ptcl_map(i) = np_recv + i;
     });
-    CopyViewsToViews<kkLidView, DataTypes>(recv_particle, new_particle_info, new_ptcl_map);
+    CopyViewsToViews<kkLidView, DataTypes>(recv_particle, new_particle_info, new_ptcl_map,
+                                           exec);
 
+    /********** Unpack each neighbor's records as its message arrives *********/
+    //The local work above and the unpacking of earlier messages overlap the remaining receives
+    if (rounds > 1)
+      unpackMigrateRecords(recv_buffer, recv_element, recv_particle, 0, np_recv);
+    else {
+      for (lid_t completed = 0; completed < num_recvs; ++completed) {
+        int index;
+        phase_timer.reset();
+        PS_Comm_Waitany<device_type>(num_recvs, recv_requests, &index, MPI_STATUS_IGNORE);
+        stats.wait_seconds += phase_timer.seconds();
+        completeReceive(index);
+        unpackMigrateRecords(recv_buffer, recv_element, recv_particle, recv_starts[index],
+                             recv_sizes[index]);
+      }
+    }
+    delete [] recv_requests;
 
     /********** Combine and shift particles to their new destination **********/
+    phase_timer.reset();
     rebuild(new_element, recv_element, recv_particle);
+    stats.rebuild_seconds = phase_timer.seconds();
 
     //Cleanup
-    PS_Comm_Waitall<device_type>(num_sends, send_requests, MPI_STATUSES_IGNORE);
+    phase_timer.reset();
+    PS_Comm_Waitall<device_type>(send_num, send_requests, MPI_STATUSES_IGNORE);
     delete [] send_requests;
-    destroyViews<DataTypes, memory_space>(send_particle);
-    destroyViews<DataTypes, memory_space>(recv_particle);
+    MPI_Waitall(done_requests.size(), done_requests.data(), MPI_STATUSES_IGNORE);
+    stats.wait_seconds += phase_timer.seconds();
+    stats.num_ptcls = num_ptcls;
+    stats.total_seconds = timer.seconds();
 
     if(!world_rank || world_rank == world_size/2)
       fprintf(stderr, "%d ps particle migration (seconds) %f pre-barrier "
@@ -221,4 +463,175 @@ namespace pumipic {
 
     Kokkos::Profiling::popRegion();
   }
+
+  template<class DataTypes, typename MemSpace>
+  lid_t SellCSigma<DataTypes, MemSpace>::forwardMigrateRecords(Distributor<MemSpace>& dist,
+                                                               lid_t np_recv, int rounds) {
+    const execution_space exec = space();
+    const std::size_t ptcl_bytes = PackedParticle<MigrationHeader, DataTypes>::bytes;
+    const lid_t comm_size = dist.num_ranks();
+    int comm_rank;
+    MPI_Comm_rank(dist.mpi_comm(), &comm_rank);
+    const DistributorLookup<MemSpace> lookup = dist.lookup();
+
+    //Counts, offsets and placement cursors per neighbor followed by the number of arrivals
+    // and the number of records without a route
+    const lid_t ncounts = comm_size + 1;
+    reserveMigrateView(migrate_forward_counts, 5 * ncounts + 2, "migrate_forward_counts");
+    reserveMigrateView(migrate_forward_counts_host, 5 * ncounts + 2,
+                       "migrate_forward_counts_host");
+    auto num_send = Kokkos::subview(migrate_forward_counts, std::make_pair(0, ncounts));
+    auto num_recv = Kokkos::subview(migrate_forward_counts, std::make_pair(ncounts, 2 * ncounts));
+    auto offset_send = Kokkos::subview(migrate_forward_counts,
+                                       std::make_pair(2 * ncounts, 3 * ncounts));
+    auto offset_recv = Kokkos::subview(migrate_forward_counts,
+                                       std::make_pair(3 * ncounts, 4 * ncounts));
+    auto cursor = Kokkos::subview(migrate_forward_counts,
+                                  std::make_pair(4 * ncounts, 5 * ncounts));
+    auto num_arrived = Kokkos::subview(migrate_forward_counts,
+                                       std::make_pair(5 * ncounts, 5 * ncounts + 1));
+    auto offset_send_host = Kokkos::subview(migrate_forward_counts_host,
+                                            std::make_pair(2 * ncounts, 3 * ncounts));
+    auto offset_recv_host = Kokkos::subview(migrate_forward_counts_host,
+                                            std::make_pair(3 * ncounts, 4 * ncounts));
+    auto num_arrived_host = Kokkos::subview(migrate_forward_counts_host,
+                                            std::make_pair(5 * ncounts, 5 * ncounts + 1));
+    auto num_unroutable = Kokkos::subview(migrate_forward_counts,
+                                          std::make_pair(5 * ncounts + 1, 5 * ncounts + 2));
+    auto num_unroutable_host = Kokkos::subview(migrate_forward_counts_host,
+                                               std::make_pair(5 * ncounts + 1,
+                                                              5 * ncounts + 2));
+
+    lid_t np_arrived = 0;
+    for (int round = 1; ; ++round) {
+      //Arrivals accumulate over the rounds so the buffer keeps its records when it grows
+      const std::size_t arrive_bytes = (np_arrived + np_recv) * ptcl_bytes;
+      if (migrate_arrive_buffer.size() < arrive_bytes)
+        Kokkos::resize(migrate_arrive_buffer, arrive_bytes * 1.1);
+      reserveMigrateView(migrate_forward_buffer, np_recv * ptcl_bytes, "migrate_forward_buffer");
+      PackedBuffer<device_type> recv_buffer = migrate_recv_buffer;
+      PackedBuffer<device_type> arrive_buffer = migrate_arrive_buffer;
+      PackedBuffer<device_type> forward_buffer = migrate_forward_buffer;
+
+      //Count the records for each next hop
+      Kokkos::deep_copy(exec, migrate_forward_counts, 0);
+      Kokkos::parallel_for(RangePolicyType(exec, 0, np_recv), KOKKOS_LAMBDA(const lid_t& i) {
+        const std::size_t record = i;
+        const MigrationHeader* header =
+          reinterpret_cast<const MigrationHeader*>(recv_buffer.data() + record * ptcl_bytes);
+        if (header->dest == comm_rank)
+          return;
+        const lid_t next = lookup.route(header->dest);
+        if (next >= 0)
+          Kokkos::atomic_fetch_add(&(num_send(next)), 1);
+      });
+      exclusive_scan(num_send, offset_send, exec);
+      Kokkos::deep_copy(exec, cursor, offset_send);
+
+      //Copy each record to the arrivals or to the records for its next hop
+      const lid_t arrive_start = np_arrived;
+      Kokkos::parallel_for(RangePolicyType(exec, 0, np_recv), KOKKOS_LAMBDA(const lid_t& i) {
+        const std::size_t record = i;
+        const char* src = recv_buffer.data() + record * ptcl_bytes;
+        const lid_t dest = reinterpret_cast<const MigrationHeader*>(src)->dest;
+        char* dst;
+        if (dest == comm_rank) {
+          const std::size_t index = arrive_start + Kokkos::atomic_fetch_add(&(num_arrived(0)), 1);
+          dst = arrive_buffer.data() + index * ptcl_bytes;
+        }
+        else {
+          //Records that can not be routed from this rank are dropped
+          const lid_t next = lookup.route(dest);
+          if (next < 0) {
+            Kokkos::atomic_fetch_add(&(num_unroutable(0)), 1);
+            return;
+          }
+          const std::size_t index = Kokkos::atomic_fetch_add(&(cursor(next)), 1);
+          dst = forward_buffer.data() + index * ptcl_bytes;
+        }
+        for (std::size_t b = 0; b < ptcl_bytes; ++b)
+          dst[b] = src[b];
+      });
+      Kokkos::deep_copy(exec, offset_send_host, offset_send);
+      Kokkos::deep_copy(exec, num_arrived_host, num_arrived);
+      Kokkos::deep_copy(exec, num_unroutable_host, num_unroutable);
+      exec.fence();
+      if (num_unroutable_host(0) > 0)
+        fprintf(stderr, "[ERROR] %d particles on rank %d have no route to their process\n",
+                num_unroutable_host(0), comm_rank);
+      np_arrived += num_arrived_host(0);
+      const lid_t np_forward = offset_send_host(comm_size);
+      if (round == rounds) {
+        if (np_forward > 0)
+          fprintf(stderr, "[ERROR] %d particles on rank %d did not reach their process in %d "
+                  "hops\n", np_forward, comm_rank, rounds);
+        break;
+      }
+
+      //Exchange the number of records forwarded with each neighbor
+      MPI_Request count_request;
+      PS_Comm_Ineighbor_alltoall(num_send, 1, num_recv, 1, dist.neighbor_comm(), &count_request);
+      PS_Comm_Waitall<device_type>(1, &count_request, MPI_STATUSES_IGNORE);
+      exclusive_scan(num_recv, offset_recv, exec);
+      Kokkos::deep_copy(exec, offset_recv_host, offset_recv);
+      exec.fence();
+      np_recv = offset_recv_host(comm_size);
+      reserveMigrateView(migrate_recv_buffer, np_recv * ptcl_bytes, "migrate_recv_buffer");
+      recv_buffer = migrate_recv_buffer;
+
+      //Forward the records to each neighbor
+      std::vector<MPI_Request> requests;
+      requests.reserve(2 * comm_size);
+      for (lid_t i = 0; i < comm_size; ++i) {
+        const int rank = dist.rank_host(i);
+        if (rank == comm_rank)
+          continue;
+        const lid_t send_size = offset_send_host(i+1) - offset_send_host(i);
+        if (send_size > 0) {
+          requests.push_back(MPI_REQUEST_NULL);
+          PS_Comm_Isend(forward_buffer, offset_send_host(i) * ptcl_bytes, send_size * ptcl_bytes,
+                        rank, 1, dist.mpi_comm(), &requests.back());
+        }
+        const lid_t recv_size = offset_recv_host(i+1) - offset_recv_host(i);
+        if (recv_size > 0) {
+          requests.push_back(MPI_REQUEST_NULL);
+          PS_Comm_Irecv(recv_buffer, offset_recv_host(i) * ptcl_bytes, recv_size * ptcl_bytes,
+                        rank, 1, dist.mpi_comm(), &requests.back());
+        }
+      }
+      PS_Comm_Waitall<device_type>(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    //The arrivals become the received records
+    std::swap(migrate_recv_buffer, migrate_arrive_buffer);
+    return np_arrived;
+  }
+
+  template<class DataTypes, typename MemSpace>
+  void SellCSigma<DataTypes, MemSpace>::unpackMigrateRecords(PackedBuffer<device_type> recv_buffer,
+                                                             kkLidView recv_element,
+                                                             MTVs recv_particle,
+                                                             lid_t start, lid_t size) {
+    const execution_space exec = space();
+    const std::size_t ptcl_bytes = PackedParticle<MigrationHeader, DataTypes>::bytes;
+    auto element_gid_to_lid_local = element_gid_to_lid;
+    Kokkos::parallel_for(RangePolicyType(exec, start, start + size),
+                         KOKKOS_LAMBDA(const lid_t& i) {
+      const std::size_t record = i;
+      const MigrationHeader* header =
+        reinterpret_cast<const MigrationHeader*>(recv_buffer.data() + record * ptcl_bytes);
+      recv_element(i) = element_gid_to_lid_local.find(header->gid);
+    });
+    UnpackViews<device_type, MigrationHeader, DataTypes>(recv_particle, recv_buffer, start, size,
+                                                          exec);
+  }
+
+  template<class DataTypes, typename MemSpace>
+  template <typename ViewT>
+  void SellCSigma<DataTypes, MemSpace>::reserveMigrateView(ViewT& view, std::size_t size,
+                                                           const char* name) {
+    //Grow with the same 10% slack as the swap space so steady state steps do not allocate
+    if (view.size() < size)
+      view = ViewT(name, size * 1.1);
+  }
 }
@@ -5,6 +5,10 @@ namespace pumipic {
     bool SellCSigma<DataTypes,MemSpace>::reshuffle(kkLidView new_element,
                                                    kkLidView new_particle_elements,
                                                    MTVs new_particles) {
+    const execution_space exec = space();
+    //Device side counters read back in a single transfer
+    // [0] reshuffle failure flag, [1] particles leaving the structure, [2] moving particles
+    kkLidView reshuffle_counts("reshuffle_counts", 3);
     //Count current/new particles per row
     kkLidView new_particles_per_row("new_particles_per_row", numRows()+1);
     kkLidView num_holes_per_row("num_holes_per_row", numRows());
@@ -22,40 +26,48 @@ namespace pumipic {
       }
       particle_mask_local(particle_id) = is_particle;
       Kokkos::atomic_fetch_add(&(num_holes_per_row(row)), !is_particle);
+      Kokkos::atomic_fetch_add(&(reshuffle_counts(1)), mask & !is_particle);
     };
     parallel_for(countNewParticles, "countNewParticles");
     // Add new particles to counts
-    Kokkos::parallel_for("reshuffle_count", new_particle_elements.size(), KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for("reshuffle_count",
+                         RangePolicyType(exec, 0, new_particle_elements.size()),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t new_elem = new_particle_elements(i);
         const lid_t new_row = element_to_row_local(new_elem);
         Kokkos::atomic_fetch_add(&(new_particles_per_row(new_row)), 1);
       });
 
     //Check if the particles will fit in current structure
-    kkLidView fail("fail",1);
-    Kokkos::parallel_for(numRows(), KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, numRows()), KOKKOS_LAMBDA(const lid_t& i) {
         if( new_particles_per_row(i) > num_holes_per_row(i))
-          fail(0) = 1;
+          reshuffle_counts(0) = 1;
       });
 
-    if (getLastValue<lid_t>(fail)) {
-      //Reshuffle fails
-      return false;
-    }
-
     //Offset moving particles
     kkLidView offset_new_particles("offset_new_particles", numRows() + 1);
     kkLidView counting_offset_index("counting_offset_index", numRows() + 1);
-    exclusive_scan(new_particles_per_row, offset_new_particles);
-    Kokkos::deep_copy(counting_offset_index, offset_new_particles);
+    exclusive_scan(new_particles_per_row, offset_new_particles, exec);
+    const lid_t last_row = numRows();
+    Kokkos::parallel_for(RangePolicyType(exec, 0, 1), KOKKOS_LAMBDA(const lid_t&) {
+        reshuffle_counts(2) = offset_new_particles(last_row);
+      });
+    kkLidHostMirror reshuffle_counts_host = create_mirror_view(reshuffle_counts);
+    Kokkos::deep_copy(exec, reshuffle_counts_host, reshuffle_counts);
+    exec.fence();
 
-    int num_moving_ptcls = getLastValue<lid_t>(offset_new_particles);
+    if (reshuffle_counts_host(0)) {
+      //Reshuffle fails
+      return false;
+    }
+    //Leaving particles are removed and every new particle fills a hole
+    const lid_t new_num_ptcls = num_ptcls - reshuffle_counts_host(1) + new_particle_elements.size();
+    int num_moving_ptcls = reshuffle_counts_host(2);
     if (num_moving_ptcls == 0) {
-      Kokkos::parallel_reduce(capacity(), KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
-          sum += particle_mask_local(i);
-        }, num_ptcls);
+      num_ptcls = new_num_ptcls;
       return true;
     }
+    Kokkos::deep_copy(exec, counting_offset_index, offset_new_particles);
     kkLidView movingPtclIndices("movingPtclIndices", num_moving_ptcls);
     kkLidView isFromSCS("isFromSCS", num_moving_ptcls);
     //Gather moving particle list
@@ -74,7 +86,9 @@ namespace pumipic {
     parallel_for(gatherMovingPtcls, "gatherMovingPtcls");
 
     //Gather new particles in list
-    Kokkos::parallel_for("reshuffle_count", new_particle_elements.size(), KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for("reshuffle_count",
+                         RangePolicyType(exec, 0, new_particle_elements.size()),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t new_elem = new_particle_elements(i);
         const lid_t new_row = element_to_row_local(new_elem);
         const lid_t index = Kokkos::atomic_fetch_add(&(counting_offset_index(new_row)), 1);
@@ -97,7 +111,8 @@ namespace pumipic {
     parallel_for(assignPtclsToHoles, "assignPtclsToHoles");
 
     //Update particle mask
-    Kokkos::parallel_for(num_moving_ptcls, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for(RangePolicyType(exec, 0, num_moving_ptcls),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t old_index = movingPtclIndices(i);
         const lid_t new_index = holes(i);
         const lid_t fromSCS = isFromSCS(i);
@@ -110,12 +125,9 @@ namespace pumipic {
     ShuffleParticles<SellCSigma<DataTypes, MemSpace>, DataTypes>(ptcl_data,
                                                                  new_particles,
                                                                  movingPtclIndices, holes,
-                                                                 isFromSCS);
+                                                                 isFromSCS, exec);
 
-    //Count number of active particles
-    Kokkos::parallel_reduce(capacity(), KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
-        sum += particle_mask_local(i);
-      }, num_ptcls);
+    num_ptcls = new_num_ptcls;
     return true;
   }
 
@@ -129,6 +141,7 @@ namespace pumipic {
     int comm_rank, comm_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    const execution_space exec = space();
 
     //Count particles including new and leaving
     kkLidView new_particles_per_elem("new_particles_per_elem", numRows());
@@ -139,14 +152,16 @@ namespace pumipic {
     };
     parallel_for(countNewParticles, "countNewParticles");
     // Add new particles to counts
-    Kokkos::parallel_for("rebuild_count", new_particle_elements.size(), KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for("rebuild_count", RangePolicyType(exec, 0, new_particle_elements.size()),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t new_elem = new_particle_elements(i);
         Kokkos::atomic_fetch_add(&(new_particles_per_elem(new_elem)), 1);
       });
 
     //Reduce the count of particles
     lid_t activePtcls;
-    Kokkos::parallel_reduce(numRows(), KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
+    Kokkos::parallel_reduce(RangePolicyType(exec, 0, numRows()),
+                            KOKKOS_LAMBDA(const lid_t& i, lid_t& sum) {
         sum+= new_particles_per_elem(i);
       }, activePtcls);
 
@@ -158,6 +173,7 @@ namespace pumipic {
         local_mask(p) = false;
       };
       parallel_for(resetMask, "resetMask");
+      exec.fence();
       if(!comm_rank || comm_rank == comm_size/2)
         fprintf(stderr, "%d ps rebuild (seconds) %f pre-barrier (seconds) %f\n",
                 comm_rank, timer.seconds(), btime);
@@ -202,7 +218,7 @@ namespace pumipic {
                      new_capacity);
 
     //Allocate the SCS
-    lid_t new_cap = getLastValue<lid_t>(new_offsets);
+    const lid_t new_cap = new_capacity;
     kkLidView new_particle_mask("new_particle_mask", new_cap);
     if (swap_size < new_cap) {
       destroyViews<DataTypes, memory_space>(scs_data_swap);
@@ -213,7 +229,7 @@ namespace pumipic {
 
     /* //Fill the SCS */
     kkLidView interior_slice_of_chunk("interior_slice_of_chunk", new_num_slices);
-    Kokkos::parallel_for("set_interior_slice_of_chunk", Kokkos::RangePolicy<>(1,new_num_slices),
+    Kokkos::parallel_for("set_interior_slice_of_chunk", RangePolicyType(exec, 1, new_num_slices),
                          KOKKOS_LAMBDA(const lid_t& i) {
                            const lid_t my_chunk = new_slice_to_chunk(i);
                            const lid_t prev_chunk = new_slice_to_chunk(i-1);
@@ -221,7 +237,8 @@ namespace pumipic {
                          });
     lid_t C_local = C_;
     kkLidView element_index("element_index", new_nchunks * C_local);
-    Kokkos::parallel_for("set_element_index", new_num_slices, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for("set_element_index", RangePolicyType(exec, 0, new_num_slices),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         const lid_t chunk = new_slice_to_chunk(i);
         for (lid_t e = 0; e < C_local; ++e) {
           Kokkos::atomic_fetch_add(&element_index(chunk*C_local + e),
@@ -248,7 +265,8 @@ namespace pumipic {
     lid_t num_new_ptcls = new_particle_elements.size();
     kkLidView new_particle_indices("new_particle_scs_indices", num_new_ptcls);
 
-    Kokkos::parallel_for("set_new_particle", num_new_ptcls, KOKKOS_LAMBDA(const lid_t& i) {
+    Kokkos::parallel_for("set_new_particle", RangePolicyType(exec, 0, num_new_ptcls),
+                         KOKKOS_LAMBDA(const lid_t& i) {
         lid_t new_elem = new_particle_elements(i);
         lid_t new_row = new_element_to_row(new_elem);
         new_particle_indices(i) = Kokkos::atomic_fetch_add(&element_index(new_row), new_C);
@@ -257,7 +275,8 @@ namespace pumipic {
       });
 
     if (new_particle_elements.size() > 0)
-      CopyViewsToViews<kkLidView, DataTypes>(scs_data_swap, new_particles, new_particle_indices);
+      CopyViewsToViews<kkLidView, DataTypes>(scs_data_swap, new_particles, new_particle_indices,
+                                             exec);
 
     //set scs to point to new values
     C_ = new_C;
@@ -277,6 +296,7 @@ namespace pumipic {
     std::size_t tmp_size = current_size;
     current_size = swap_size;
     swap_size = tmp_size;
+    exec.fence();
     if(!comm_rank || comm_rank == comm_size/2)
       fprintf(stderr, "%d ps rebuild (seconds) %f pre-barrier (seconds) %f\n",
               comm_rank, timer.seconds(), btime);
@@ -5,6 +5,7 @@ namespace pumipic {
                                                     lid_t num_elems,
                                                     kkLidView ptcls_per_elem,
                                                     lid_t sigma){
+    const execution_space exec = space();
     //Make temporary copy of the particle counts for sorting
     ptcl_pairs = PairView("ptcl_pairs", num_elems);
     if (sigma > 1) {
@@ -12,25 +13,26 @@ namespace pumipic {
 #ifdef PP_USE_CUDA
       Kokkos::View<lid_t*, typename MemSpace::device_type> elem_ids("elem_ids", num_elems);
       Kokkos::View<lid_t*, typename MemSpace::device_type> temp_ppe("temp_ppe", num_elems);
-      Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
+      Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
           temp_ppe(i) = ptcls_per_elem(i);
           elem_ids(i) = i;
         });
       thrust::device_ptr<lid_t> ptcls_t(temp_ppe.data());
       thrust::device_ptr<lid_t> elem_ids_t(elem_ids.data());
       for (i = 0; i < num_elems - sigma; i+=sigma) {
-        thrust::sort_by_key(thrust::device, ptcls_t + i, ptcls_t + i + sigma, elem_ids_t + i);
+        thrust::sort_by_key(thrustPolicy(exec), ptcls_t + i, ptcls_t + i + sigma, elem_ids_t + i);
       }
-      thrust::sort_by_key(thrust::device, ptcls_t + i, ptcls_t + num_elems, elem_ids_t + i);
-      Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
+      thrust::sort_by_key(thrustPolicy(exec), ptcls_t + i, ptcls_t + num_elems, elem_ids_t + i);
+      Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
           ptcl_pairs(num_elems - 1 - i).first = temp_ppe(i);
           ptcl_pairs(num_elems - 1 - i).second = elem_ids(i);
         });
 #else
-      Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
+      Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
         ptcl_pairs(i).first = ptcls_per_elem(i);
         ptcl_pairs(i).second = i;
       });
+      exec.fence();
       typename PairView::HostMirror ptcl_pairs_host = deviceToHost(ptcl_pairs);
       MyPair* ptcl_pair_data = ptcl_pairs_host.data();
       for (i = 0; i < num_elems - sigma; i+=sigma) {
@@ -41,7 +43,7 @@ namespace pumipic {
 #endif
     }
     else {
-      Kokkos::parallel_for(num_elems, KOKKOS_LAMBDA(const lid_t& i) {
+      Kokkos::parallel_for(RangePolicyType(exec, 0, num_elems), KOKKOS_LAMBDA(const lid_t& i) {
         ptcl_pairs(i).first = ptcls_per_elem(i);
         ptcl_pairs(i).second = i;
       });
@@ -10,7 +10,7 @@
 #include <climits>
 #include <particle_structure.hpp>
 #include <ppAssert.h>
-#include <Kokkos_UnorderedMap.hpp>
+#include <psSortedIndex.hpp>
 #include <Kokkos_Pair.hpp>
 #include <Kokkos_Sort.hpp>
 #include "SCSPair.h"
@@ -49,8 +49,9 @@ class SellCSigma : public ParticleStructure<DataTypes, MemSpace> {
 template <std::size_t N> using Slice = Segment<DataType<N>, device_type>;
 #endif
   typedef Kokkos::TeamPolicy<execution_space> PolicyType;
+  typedef Kokkos::RangePolicy<execution_space> RangePolicyType;
   typedef Kokkos::View<MyPair*, device_type> PairView;
-  typedef Kokkos::UnorderedMap<gid_t, lid_t, device_type> GID_Mapping;
+  typedef SortedIndex<gid_t, device_type> GID_Mapping;
   typedef SCS_Input<DataTypes, MemSpace> Input_T;
 
   SellCSigma() = delete;
@@ -58,6 +59,7 @@ template <std::size_t N> using Slice = Segment<DataType<N>, device_type>;
   SellCSigma& operator=(const SellCSigma&) = delete;
   /* Constructor of SellCSigma as particle structure
     p - a Kokkos::TeamPolicy that defines the value of C based on the device
+        The execution space instance of the policy is used for all kernels of the structure
     sigma - the sorting parameter 1 = no sorting, INT_MAX = full sorting
     vertical_chunk_size - tuning parameter for load balancing of irregular row lengths
     num_elements - the number of elements in the mesh
@@ -94,6 +96,16 @@ template <std::size_t N> using Slice = Segment<DataType<N>, device_type>;
   //Change whether or not to try shuffling
   void setShuffling(bool newS) {tryShuffling = newS;}
 
+  //Returns the execution space instance all kernels of the structure are enqueued on
+  execution_space space() const {return policy.space();}
+  /* Change the execution space instance used by rebuild/migrate/parallel_for
+       Structures on different instances can rebuild concurrently
+       Note: the caller must fence the previous instance before switching
+  */
+  void setSpace(const execution_space& exec) {
+    policy = PolicyType(exec, policy.league_size(), policy.team_size());
+  }
+
   /* Migrates each particle to new_process and to new_element
      Calls rebuild to recreate the SCS after migrating particles
      new_element - array sized scs->capacity with the new element for each particle
@@ -205,14 +217,42 @@ template <std::size_t N> using Slice = Segment<DataType<N>, device_type>;
   MTVs scs_data_swap;
   std::size_t current_size, swap_size;
 
+  //Buffers reused by migrate across calls, they only grow
+  kkLidView migrate_counts;
+  kkLidHostMirror migrate_counts_host;
+  kkLidView migrate_send_index;
+  PackedBuffer<device_type> migrate_send_buffer;
+  PackedBuffer<device_type> migrate_recv_buffer;
+  kkLidView migrate_recv_element;
+  kkLidView migrate_new_index;
+  MTVs migrate_recv_particle;
+  lid_t migrate_recv_size;
+  //Buffers for records forwarded through neighbors (see Distributor::maxHops)
+  kkLidView migrate_forward_counts;
+  kkLidHostMirror migrate_forward_counts_host;
+  PackedBuffer<device_type> migrate_forward_buffer;
+  PackedBuffer<device_type> migrate_arrive_buffer;
+  //Buffers of encoded records (see Distributor::codec)
+  PackedBuffer<device_type> migrate_encode_buffer;
+  PackedBuffer<device_type> migrate_decode_buffer;
+  kkLidView migrate_encoded_counts;
+  kkLidHostMirror migrate_encoded_counts_host;
+  template <typename ViewT>
+  void reserveMigrateView(ViewT& view, std::size_t size, const char* name);
+  //Forwards received records that are not for this process, returns the number arrived
+  lid_t forwardMigrateRecords(Distributor<MemSpace>& dist, lid_t np_recv, int rounds);
+  //Sets the element and member values of records [start, start + size) of recv_buffer
+  void unpackMigrateRecords(PackedBuffer<device_type> recv_buffer, kkLidView recv_element,
+                            MTVs recv_particle, lid_t start, lid_t size);
+
   //Padding terms
   double extra_padding;
   double shuffle_padding;
   PaddingStrategy pad_strat;
   //True - try shuffling every rebuild, false - only rebuild
   bool tryShuffling;
-  //Metric Info
-  lid_t num_empty_elements;
+  //Metric Info (kept on the device to avoid a host sync during rebuild)
+  kkLidView num_empty_elements;
 
   //Private construct function
   void construct(kkLidView ptcls_per_elem,
@@ -221,7 +261,8 @@ template <std::size_t N> using Slice = Segment<DataType<N>, device_type>;
                  MTVs particle_info);
   void destroy();
 
-  SellCSigma(lid_t Cmax) : ParticleStructure<DataTypes, MemSpace>(), policy(PolicyType(1000,Cmax)) {};
+  SellCSigma(lid_t Cmax) : ParticleStructure<DataTypes, MemSpace>(), policy(PolicyType(1000,Cmax)),
+                           migrate_recv_particle(NULL), migrate_recv_size(0) {};
 
 };
 
@@ -232,6 +273,8 @@ void SellCSigma<DataTypes, MemSpace>::construct(kkLidView ptcls_per_elem,
                                                 MTVs particle_info) {
   Kokkos::Profiling::pushRegion("scs_construction");
   tryShuffling = true;
+  migrate_recv_particle = NULL;
+  migrate_recv_size = 0;
   int comm_size;
   MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
   int comm_rank;
@@ -280,6 +323,7 @@ void SellCSigma<DataTypes, MemSpace>::construct(kkLidView ptcls_per_elem,
       initSCSData(chunk_starts, particle_elements, particle_info);
     }
   }
+  space().fence();
   Kokkos::Profiling::popRegion();
 }
 
@@ -290,7 +334,7 @@ SellCSigma<DataTypes, MemSpace>::SellCSigma(PolicyType& p, lid_t sig, lid_t v, l
                                             kkGidView element_gids,
                                             kkLidView particle_elements,
                                             MTVs particle_info) :
-  ParticleStructure<DataTypes, MemSpace>(), policy(p), element_gid_to_lid(ne) {
+  ParticleStructure<DataTypes, MemSpace>(), policy(p) {
   //Set variables
   sigma = sig;
   V_ = v;
@@ -304,7 +348,7 @@ SellCSigma<DataTypes, MemSpace>::SellCSigma(PolicyType& p, lid_t sig, lid_t v, l
 
 template<class DataTypes, typename MemSpace>
 SellCSigma<DataTypes, MemSpace>::SellCSigma(Input_T& input) :
-  ParticleStructure<DataTypes, MemSpace>(), policy(input.policy), element_gid_to_lid(input.ne) {
+  ParticleStructure<DataTypes, MemSpace>(), policy(input.policy) {
   sigma = input.sig;
   V_ = input.V;
   num_elems = input.ne;
@@ -334,7 +378,6 @@ SellCSigma<DataTypes, MemSpace>::Mirror<MSpace>* SellCSigma<DataTypes, MemSpace>
   mirror_copy->shuffle_padding = shuffle_padding;
   mirror_copy->pad_strat = pad_strat;
   mirror_copy->tryShuffling = tryShuffling;
-  mirror_copy->num_empty_elements = num_empty_elements;
 
   //Create the swap space
   mirror_copy->scs_data_swap = createMemberViews<DataTypes, memory_space>(swap_size);
@@ -356,6 +399,9 @@ SellCSigma<DataTypes, MemSpace>::Mirror<MSpace>* SellCSigma<DataTypes, MemSpace>
   mirror_copy->element_to_gid = typename Mirror<MSpace>::kkGidView("mirror element_to_gid",
                                                                    element_to_gid.size());
   Kokkos::deep_copy(mirror_copy->element_to_gid, element_to_gid);
+  mirror_copy->num_empty_elements = typename Mirror<MSpace>::kkLidView("mirror num_empty_elements",
+                                                                       1);
+  Kokkos::deep_copy(mirror_copy->num_empty_elements, num_empty_elements);
   //Deep copy the gid mapping
   mirror_copy->element_gid_to_lid.create_copy_view(element_gid_to_lid);
   return mirror_copy;
@@ -366,6 +412,8 @@ template<class DataTypes, typename MemSpace>
 void SellCSigma<DataTypes, MemSpace>::destroy() {
   destroyViews<DataTypes, memory_space>(ptcl_data);
   destroyViews<DataTypes, memory_space>(scs_data_swap);
+  if (migrate_recv_particle != NULL)
+    destroyViews<DataTypes, memory_space>(migrate_recv_particle);
 }
 template<class DataTypes, typename MemSpace>
 SellCSigma<DataTypes, MemSpace>::~SellCSigma() {
@@ -425,7 +473,7 @@ void SellCSigma<DataTypes, MemSpace>::printMetrics() const {
   kkLidView padded_slices("padded_slices", 1);
   const lid_t league_size = num_slices;
   const lid_t team_size = C_;
-  const PolicyType policy(league_size, team_size);
+  const PolicyType policy(space(), league_size, team_size);
   auto offsets_cpy = offsets;
   auto slice_to_chunk_cpy = slice_to_chunk;
   auto row_to_element_cpy = row_to_element;
@@ -452,6 +500,7 @@ void SellCSigma<DataTypes, MemSpace>::printMetrics() const {
 
   lid_t num_padded = getLastValue<lid_t>(padded_cells);
   lid_t num_padded_slices = getLastValue<lid_t>(padded_slices);
+  lid_t num_empty = getLastValue<lid_t>(num_empty_elements);
 
   int comm_rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
@@ -471,8 +520,8 @@ void SellCSigma<DataTypes, MemSpace>::printMetrics() const {
   ptr += sprintf(ptr, "Padded Slices <Tot %%> %d %.3f\n", num_padded_slices,
                  num_padded_slices * 100.0 / num_slices);
   //Empty Elements
-  ptr += sprintf(ptr, "Empty Rows <Tot %%> %d %.3f\n", num_empty_elements,
-                 num_empty_elements * 100.0 / numRows());
+  ptr += sprintf(ptr, "Empty Rows <Tot %%> %d %.3f\n", num_empty,
+                 num_empty * 100.0 / numRows());
 
   printf("%s\n",buffer);
 }
@@ -491,7 +540,7 @@ void SellCSigma<DataTypes, MemSpace>::parallel_for(FunctionType& fn, std::string
 #endif
   const lid_t league_size = num_slices;
   const lid_t team_size = C_;
-  const PolicyType policy(league_size, team_size);
+  const PolicyType policy(space(), league_size, team_size);
   auto offsets_cpy = offsets;
   auto slice_to_chunk_cpy = slice_to_chunk;
   auto row_to_element_cpy = row_to_element;
@@ -9,6 +9,8 @@
 #include <Kokkos_Core.hpp>
 #include <mpi.h>
 #include <cstdlib>
+#include <vector>
+#include <type_traits>
 
 namespace pumipic {
 
@@ -53,7 +55,8 @@ namespace pumipic {
                                              indices in another view
        Usage: CopyViewsToViews<ViewType, MemberTypes>(DestiationMemberTypeViews,
                                                       SourceMemberTypeViews,
-                                                      DestionationIndexPerSource);
+                                                      DestionationIndexPerSource,
+                                                      ExecutionSpaceInstance [optional]);
   */
   template <typename PS, typename... Types> struct CopyViewsToViews;
   /* ShuffleParticles<ParticleStructure, DataTypes> - shuffles particle info within a ps
@@ -62,7 +65,8 @@ namespace pumipic {
                                                                NewPtclMemberTypeViews,
                                                                SourceIndex,
                                                                DestinationIndex,
-                                                               IfEntryIsDrawnFromPS);
+                                                               IfEntryIsDrawnFromPS,
+                                                               ExecutionSpaceInstance [optional]);
    */
   template <typename Device, typename... Types> struct ShuffleParticles;
   /* SendViews<Device, DataTypes> - sends views with MPI communications
@@ -83,6 +87,34 @@ namespace pumipic {
                                                                                   SourceMTV)
   */
   template <typename MSpace1, typename MSpace2, typename... Types> struct CopyMemSpaceToMemSpace;
+  /* PackedParticle<Header, DataTypes> - compile time layout of one particle record in a
+                                         packed buffer
+       PackedParticle<Header, MemberTypes>::bytes is the size of a record. The Header is
+       stored at the start of the record followed by each member type aligned to its type.
+  */
+  template <typename Header, typename... Types> struct PackedParticle;
+  /* PackedMembers<Header, DataTypes> - runtime description of the members of a record
+       Usage: std::vector<PackedMember> members;
+              PackedMembers<Header, MemberTypes> describe(members);
+       Note: One entry is appended per member type in order, the header is not included
+  */
+  struct PackedMember {
+    std::size_t offset;
+    std::size_t bytes;
+    bool is_double;
+  };
+  template <typename Header, typename... Types> struct PackedMembers;
+  /* UnpackViews<Device, Header, DataTypes> - copies the members of packed records into
+                                              member views
+       Usage: UnpackViews<Device, Header, MemberTypes>(DestinationMemberTypeViews,
+                                                       PackedBuffer, firstRecord,
+                                                       numberOfRecords,
+                                                       ExecutionSpaceInstance [optional]);
+       Note: Record i is written to entry i of each member view
+  */
+  template <typename Device, typename Header, typename... Types> struct UnpackViews;
+  //Buffer of packed particle records
+  template <typename Device> using PackedBuffer = Kokkos::View<char*, Device>;
 
 
   //Functions
@@ -133,40 +165,44 @@ namespace pumipic {
   template <typename View, typename... Types> struct CopyViewsToViewsImpl;
   template <typename View> struct CopyViewsToViewsImpl<View> {
     typedef typename View::device_type Device;
+    typedef typename Device::execution_space ExecSpace;
     CopyViewsToViewsImpl(MemberTypeViewsConst,
                          MemberTypeViewsConst,
-                         View) {}
+                         View, ExecSpace) {}
   };
   template <typename View, typename T, typename... Types> struct CopyViewsToViewsImpl<View, T,Types...> {
     typedef typename View::device_type Device;
+    typedef typename Device::execution_space ExecSpace;
     CopyViewsToViewsImpl(MemberTypeViewsConst dsts,
                          MemberTypeViewsConst srcs,
-                         View ps_indices) {
-      enclose(dsts,srcs, ps_indices);
+                         View ps_indices, ExecSpace exec) {
+      enclose(dsts,srcs, ps_indices, exec);
     }
     void enclose(MemberTypeViewsConst dsts,
                  MemberTypeViewsConst srcs,
-                 View ps_indices) {
+                 View ps_indices, ExecSpace exec) {
       MemberTypeView<T, Device> dst = *static_cast<MemberTypeView<T, Device> const*>(dsts[0]);
       MemberTypeView<T, Device> src = *static_cast<MemberTypeView<T, Device> const*>(srcs[0]);
       int size = dst.extent(0);
-      Kokkos::parallel_for(ps_indices.size(), KOKKOS_LAMBDA(const int& i) {
+      Kokkos::parallel_for(Kokkos::RangePolicy<ExecSpace>(exec, 0, ps_indices.size()),
+                           KOKKOS_LAMBDA(const int& i) {
         const int index = ps_indices(i);
         if (index >= size || index < 0) {
           printf("[ERROR] copying view to view from %d to %d outside of [0-%d)\n", i, index, size);
         }
         CopyViewToView<T,Device>(dst, index, src, i);
       });
-      CopyViewsToViewsImpl<View, Types...>(dsts+1, srcs+1, ps_indices);
+      CopyViewsToViewsImpl<View, Types...>(dsts+1, srcs+1, ps_indices, exec);
     }
   };
   template <typename View, typename... Types> struct CopyViewsToViews<View, MemberTypes<Types...> > {
     typedef typename View::device_type Device;
+    typedef typename Device::execution_space ExecSpace;
     CopyViewsToViews(MemberTypeViewsConst dsts,
                      MemberTypeViewsConst srcs,
-                         View ps_indices) {
+                     View ps_indices, ExecSpace exec = ExecSpace()) {
       if (dsts != NULL && srcs != NULL)
-        CopyViewsToViewsImpl<View, Types...>(dsts, srcs, ps_indices);
+        CopyViewsToViewsImpl<View, Types...>(dsts, srcs, ps_indices, exec);
     }
   };
 
@@ -210,22 +246,27 @@ namespace pumipic {
   template <typename PS> struct ShuffleParticlesImpl<PS> {
     typedef typename PS::device_type Device;
     typedef typename PS::kkLidView LidView;
+    typedef typename PS::execution_space ExecSpace;
     ShuffleParticlesImpl(MemberTypeViewsConst ps,
                          MemberTypeViewsConst new_particles,
-                         LidView old_indices, LidView new_indices, LidView fromPS) {}
+                         LidView old_indices, LidView new_indices, LidView fromPS,
+                         ExecSpace exec) {}
   };
   template <typename PS, typename T, typename... Types>
   struct ShuffleParticlesImpl<PS, T, Types...> {
     typedef typename PS::device_type Device;
     typedef typename PS::kkLidView LidView;
+    typedef typename PS::execution_space ExecSpace;
     ShuffleParticlesImpl(MemberTypeViewsConst ps,
                          MemberTypeViewsConst new_particles,
-                         LidView old_indices, LidView new_indices, LidView fromPS) {
-      enclose(ps, new_particles, old_indices, new_indices, fromPS);
+                         LidView old_indices, LidView new_indices, LidView fromPS,
+                         ExecSpace exec) {
+      enclose(ps, new_particles, old_indices, new_indices, fromPS, exec);
     }
     void enclose(MemberTypeViewsConst ps,
                  MemberTypeViewsConst new_particles,
-                 LidView old_indices, LidView new_indices, LidView fromPS) {
+                 LidView old_indices, LidView new_indices, LidView fromPS,
+                 ExecSpace exec) {
       int nMoving = old_indices.size();
       MemberTypeView<T, Device> ps_view = *static_cast<MemberTypeView<T, Device> const*>(ps[0]);
       MemberTypeView<T, Device> new_view;
@@ -234,24 +275,28 @@ namespace pumipic {
         new_particles++;
       }
 
-      Kokkos::parallel_for(nMoving, KOKKOS_LAMBDA(const lid_t& i) {
+      Kokkos::parallel_for(Kokkos::RangePolicy<ExecSpace>(exec, 0, nMoving),
+                           KOKKOS_LAMBDA(const lid_t& i) {
           const lid_t old_index = old_indices(i);
           const lid_t new_index = new_indices(i);
           const lid_t isPS = fromPS(i);
           auto src = (isPS == 1 ? ps_view : new_view);
           CopyViewToView<T, Device>(ps_view, new_index, src, old_index);
       });
-      ShuffleParticlesImpl<PS, Types...>(ps+1, new_particles, old_indices, new_indices, fromPS);
+      ShuffleParticlesImpl<PS, Types...>(ps+1, new_particles, old_indices, new_indices, fromPS,
+                                         exec);
     }
   };
   template <typename PS, typename... Types> struct ShuffleParticles<PS, MemberTypes<Types...> > {
     typedef typename PS::device_type Device;
     typedef typename PS::kkLidView LidView;
+    typedef typename PS::execution_space ExecSpace;
     ShuffleParticles(MemberTypeViewsConst ps,
                      MemberTypeViewsConst new_particles,
-                     LidView old_indices, LidView new_indices, LidView fromPS) {
+                     LidView old_indices, LidView new_indices, LidView fromPS,
+                     ExecSpace exec = ExecSpace()) {
       ShuffleParticlesImpl<PS, Types...>(ps, new_particles, old_indices,
-                                                      new_indices, fromPS);
+                                                      new_indices, fromPS, exec);
     }
   };
 
@@ -297,6 +342,96 @@ namespace pumipic {
     }
   };
 
+  //Packed record layout
+  template <std::size_t Offset, std::size_t Align> struct AlignOffset {
+    static constexpr std::size_t value = (Offset + Align - 1) / Align * Align;
+  };
+  template <std::size_t Offset, typename... Types> struct PackedLayout;
+  template <std::size_t Offset> struct PackedLayout<Offset> {
+    static constexpr std::size_t end = Offset;
+    static constexpr std::size_t align = 1;
+  };
+  template <std::size_t Offset, typename T, typename... Types>
+  struct PackedLayout<Offset, T, Types...> {
+    static constexpr std::size_t offset = AlignOffset<Offset, alignof(T)>::value;
+    typedef PackedLayout<offset + sizeof(T), Types...> Next;
+    static constexpr std::size_t end = Next::end;
+    static constexpr std::size_t align = alignof(T) > Next::align ? alignof(T) : Next::align;
+  };
+  template <typename Header, typename... Types>
+  struct PackedParticle<Header, MemberTypes<Types...> > {
+    typedef PackedLayout<0, Header, Types...> Layout;
+    static constexpr std::size_t bytes = AlignOffset<Layout::end, Layout::align>::value;
+  };
+
+  template <std::size_t Offset, typename... Types> struct PackedMembersImpl;
+  template <std::size_t Offset> struct PackedMembersImpl<Offset> {
+    PackedMembersImpl(std::vector<PackedMember>&) {}
+  };
+  template <std::size_t Offset, typename T, typename... Types>
+  struct PackedMembersImpl<Offset, T, Types...> {
+    typedef PackedLayout<Offset, T, Types...> Layout;
+    PackedMembersImpl(std::vector<PackedMember>& members) {
+      PackedMember member;
+      member.offset = Layout::offset;
+      member.bytes = sizeof(T);
+      member.is_double = std::is_same<typename BaseType<T>::type, double>::value;
+      members.push_back(member);
+      PackedMembersImpl<Layout::offset + sizeof(T), Types...>(members);
+    }
+  };
+  template <typename Header, typename... Types>
+  struct PackedMembers<Header, MemberTypes<Types...> > {
+    PackedMembers(std::vector<PackedMember>& members) {
+      PackedMembersImpl<sizeof(Header), Types...>(members);
+    }
+  };
+
+  //Unpack currying structs
+  template <typename Device, std::size_t Stride, std::size_t Offset, typename... Types>
+  struct UnpackViewsImpl;
+  template <typename Device, std::size_t Stride, std::size_t Offset>
+  struct UnpackViewsImpl<Device, Stride, Offset> {
+    typedef typename Device::execution_space ExecSpace;
+    UnpackViewsImpl(MemberTypeViewsConst, PackedBuffer<Device>, int, int, ExecSpace) {}
+  };
+  template <typename Device, std::size_t Stride, std::size_t Offset, typename T,
+            typename... Types>
+  struct UnpackViewsImpl<Device, Stride, Offset, T, Types...> {
+    typedef typename Device::execution_space ExecSpace;
+    typedef typename BaseType<T>::type BT;
+    typedef PackedLayout<Offset, T, Types...> Layout;
+    UnpackViewsImpl(MemberTypeViewsConst dsts, PackedBuffer<Device> buffer, int start, int size,
+                    ExecSpace exec) {
+      enclose(dsts, buffer, start, size, exec);
+    }
+    void enclose(MemberTypeViewsConst dsts, PackedBuffer<Device> buffer, int start, int size,
+                 ExecSpace exec) {
+      MemberTypeView<T, Device> dst = *static_cast<MemberTypeView<T, Device> const*>(dsts[0]);
+      const std::size_t offset = Layout::offset;
+      const std::size_t stride = Stride;
+      Kokkos::parallel_for(Kokkos::RangePolicy<ExecSpace>(exec, start, start + size),
+                           KOKKOS_LAMBDA(const int& i) {
+        const std::size_t record = i;
+        const BT* src = reinterpret_cast<const BT*>(buffer.data() + record * stride + offset);
+        CopyBufferToView<T, Device>(dst, i, src);
+      });
+      UnpackViewsImpl<Device, Stride, Layout::offset + sizeof(T), Types...>(dsts + 1, buffer,
+                                                                           start, size, exec);
+    }
+  };
+  template <typename Device, typename Header, typename... Types>
+  struct UnpackViews<Device, Header, MemberTypes<Types...> > {
+    typedef typename Device::execution_space ExecSpace;
+    typedef PackedParticle<Header, MemberTypes<Types...> > Packed;
+    UnpackViews(MemberTypeViewsConst dsts, PackedBuffer<Device> buffer, int start, int size,
+                ExecSpace exec = ExecSpace()) {
+      if (dsts != NULL && size > 0)
+        UnpackViewsImpl<Device, Packed::bytes, sizeof(Header), Types...>(dsts, buffer, start,
+                                                                         size, exec);
+    }
+  };
+
   //Implementation to deallocate views of different types
   template <typename Device, typename... Types> struct DestroyViewsImpl;
   template <typename Device> struct DestroyViewsImpl<Device> {
@@ -1,17 +1,147 @@
 #pragma once
 
 #include <mpi.h>
+#include <memory>
+#include <vector>
 #include <ppTypes.h>
 #include <MemberTypeLibraries.h>
-#include <Kokkos_UnorderedMap.hpp>
+#include <psSortedIndex.hpp>
+#include <psMigrationCodec.hpp>
+#include <psMigrationStats.hpp>
 
 namespace pumipic {
+  class Mesh;
+
+  //Header of a packed particle record in migration, dest is the final process
+  struct MigrationHeader {
+    gid_t gid;
+    lid_t dest;
+  };
+
+  //Communicator shared by copies of an object, it is freed when the last copy is destroyed
+  typedef std::shared_ptr<MPI_Comm> SharedComm;
+  inline SharedComm makeSharedComm(MPI_Comm c) {
+    return SharedComm(new MPI_Comm(c), [](MPI_Comm* comm) {
+      int finalized;
+      MPI_Finalized(&finalized);
+      if (!finalized && *comm != MPI_COMM_NULL)
+        MPI_Comm_free(comm);
+      delete comm;
+    });
+  }
+  inline MPI_Comm getComm(const SharedComm& c) {return c ? *c : MPI_COMM_NULL;}
+
+  //Shared memory window of the ranks on a node, data is the segment of this rank
+  struct NodeWindow {
+    MPI_Win win;
+    char* data;
+    std::size_t size;
+    NodeWindow() : win(MPI_WIN_NULL), data(NULL), size(0) {}
+  };
+  inline void freeNodeWindow(NodeWindow& window) {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized && window.win != MPI_WIN_NULL) {
+      MPI_Win_unlock_all(window.win);
+      MPI_Win_free(&window.win);
+    }
+    window = NodeWindow();
+  }
+  //Window shared by copies of an object, it is freed when the last copy is destroyed
+  typedef std::shared_ptr<NodeWindow> SharedWindow;
+  inline SharedWindow makeSharedWindow() {
+    return SharedWindow(new NodeWindow, [](NodeWindow* window) {
+      freeNodeWindow(*window);
+      delete window;
+    });
+  }
+
+  /* Device side lookups of a Distributor
+
+     The lookups only hold views so kernels capture them by value instead of the
+     distributor, whose codec, statistics and node tables live on the host.
+   */
+  template <typename Space>
+  struct DistributorLookup {
+    typedef Kokkos::View<int*, typename Space::device_type> IndexView;
+    //List of ranks on the device (empty if every rank is a destination)
+    IndexView ranks_d;
+    //Sorted index from rank to index on device
+    SortedIndex<int, typename Space::device_type> mapping;
+    //Next hop index and hop count to each rank of the communicator, empty without
+    // forwarding
+    IndexView route_d;
+    IndexView hops_d;
+
+    PP_INLINE bool isWorld() const {return ranks_d.size() == 0;}
+    PP_INLINE int rank(int i) const {return isWorld() ? i : ranks_d(i);}
+    PP_INLINE int index(int process) const {
+      return isWorld() ? process : mapping.find(process);
+    }
+    PP_INLINE int route(int process) const {
+      if (isWorld())
+        return process;
+      //Without forwarding only the neighbors are reachable
+      if (route_d.size() == 0)
+        return index(process);
+      return route_d(process);
+    }
+    PP_INLINE int hops(int process) const {
+      if (isWorld())
+        return 1;
+      if (hops_d.size() == 0)
+        return index(process) < 0 ? -1 : 1;
+      return hops_d(process);
+    }
+  };
+
+  /* Distributor defines the ranks particles may be migrated to
+
+     An empty rank list means every rank in the communicator is a destination.
+     Otherwise the ranks are the neighborhood of this process and a distributed graph
+     communicator is created over them so migration only communicates with neighbors.
+
+     Note: Setting the ranks is collective over the communicator and the rank lists must
+           be symmetric (if rank a lists rank b then rank b lists rank a)
+     Note: The graph and node communicators are shared by all copies of the distributor and
+           are freed with the last copy that uses them, which should happen on every rank
+           like MPI_Comm_free
+
+     Ranks outside of the neighborhood are reached by forwarding particles through
+     neighbors for up to maxHops() rounds (1 by default, no forwarding). Setting more than
+     one hop gathers every neighborhood once to build a table of the next hop and hop count
+     to each rank, which takes O(comm_size) memory per process. The table is only built by
+     distributors that forward.
+     Note: setMaxHops is collective over the communicator
+     Note: Particles sent to a rank that can not be reached stay on their process
+
+     With setNodeAware(true) the ranks sharing a node (MPI_COMM_TYPE_SHARED) exchange
+     particles through a shared memory window so on-node records are copied once instead of
+     being passed through MPI messages. The window is allocated on the node communicator,
+     grows with the migrations that use it and is shared and freed like the communicators.
+     Note: The on-node path is only used by structures in host accessible memory
+
+     Member types may be encoded while they are sent with codec() (see psMigrationCodec.hpp),
+     the codec is used for messages between neighbors that are not forwarded or on-node.
+
+     Statistics of the last migration with the distributor or one of its copies are
+     available from stats().
+
+     Kernels must capture lookup() and call its rank and index, the distributor itself can
+     not be copied to the device. rank() and index() of the distributor are kept for host
+     code and forward to the host copy of the ranks.
+
+     Distributor(Mesh&) uses this rank followed by the parts buffered by the picparts as the
+     neighborhood. It is defined in pumipic_mesh.hpp so particle_structs does not depend on
+     the mesh.
+   */
   template <typename Space = DefaultMemSpace>
   class Distributor {
   public:
     Distributor();
     Distributor(MPI_Comm c);
     Distributor(int nr, int* rnks,MPI_Comm c = MPI_COMM_WORLD);
+    Distributor(Mesh& picparts);
     template <typename ViewT>
     Distributor(ViewT ranks, MPI_Comm c = MPI_COMM_WORLD);
 
@@ -21,41 +151,80 @@ namespace pumipic {
     void buildMap();
 
     MPI_Comm mpi_comm() const {return comm;}
-    PP_INLINE bool isWorld() const {return ranks_d.size() == 0;}
+    //Graph communicator over the ranks in index order (MPI_COMM_NULL if isWorld())
+    MPI_Comm neighbor_comm() const {return getComm(graph_comm);}
+    bool isWorld() const {return lookup_.isWorld();}
     int num_ranks() const;
     int rank_host(int i) const;
-    PP_DEVICE int rank(int i) const;
-    PP_DEVICE int index(int process) const;
+    //Host side lookups, kernels use lookup().rank(i) and lookup().index(process)
+    int rank(int i) const {return rank_host(i);}
+    int index(int process) const;
+    //Lookups of the ranks for kernels
+    const DistributorLookup<Space>& lookup() const {return lookup_;}
+    //Maximum number of forwarding rounds a migration may use (collective)
+    void setMaxHops(int h);
+    int maxHops() const {return isWorld() ? 1 : max_hops;}
+
+    //Splits the communicator by node for on-node exchange (collective)
+    void setNodeAware(bool on);
+    bool isNodeAware() const {return getComm(node_comm) != MPI_COMM_NULL;}
+    //Communicator of the ranks on this node (MPI_COMM_NULL if not node aware)
+    MPI_Comm nodeComm() const {return getComm(node_comm);}
+    //Rank of process in nodeComm() (-1 if process is on another node)
+    int nodeRank(int process) const;
+    /* Grows the window of the node so each rank has at least size bytes
+         Note: collective over nodeComm(), every rank of the node must pass the same size
+    */
+    NodeWindow& reserveNodeWindow(std::size_t size);
+
+    //Codec of the member types of migrated particles
+    MigrationCodec& codec() {return codec_;}
+    const MigrationCodec& codec() const {return codec_;}
+    //Statistics of the last migration (shared by copies of the distributor)
+    MigrationStats& stats() {return *stats_;}
+    const MigrationStats& stats() const {return *stats_;}
   private:
+    void buildRoutes();
+
     MPI_Comm comm;
+    SharedComm graph_comm;
+    SharedComm node_comm;
+    SharedWindow node_window;
     int nranks;
+    int max_hops;
+    //Rank on the node of each rank of the communicator
+    Kokkos::View<int*, Kokkos::HostSpace> node_ranks;
+    MigrationCodec codec_;
+    std::shared_ptr<MigrationStats> stats_;
 
-    typedef Kokkos::View<int*, typename Space::device_type> IndexView;
-    //List of ranks on the device
-    IndexView ranks_d;
+    typedef typename DistributorLookup<Space>::IndexView IndexView;
+    DistributorLookup<Space> lookup_;
     typename IndexView::HostMirror ranks_h;
-
-    //Unordered map from rank to index on device
-    typedef Kokkos::UnorderedMap<lid_t, lid_t, typename Space::device_type> MapType;
-    MapType mapping;
   };
 
   template <typename Space>
-  Distributor<Space>::Distributor() : comm(MPI_COMM_WORLD), ranks_d("distributor_ranks_d", 0) {
-    ranks_h = deviceToHost(ranks_d);
+  Distributor<Space>::Distributor() : comm(MPI_COMM_WORLD), max_hops(1),
+                                      stats_(new MigrationStats) {
+    lookup_.ranks_d = IndexView("distributor_ranks_d", 0);
+    ranks_h = deviceToHost(lookup_.ranks_d);
   }
   template <typename Space>
-  Distributor<Space>::Distributor(MPI_Comm c) : comm(c),  ranks_d("distributor_ranks_d", 0) {
-    ranks_h = deviceToHost(ranks_d);
+  Distributor<Space>::Distributor(MPI_Comm c) : comm(c), max_hops(1),
+                                      stats_(new MigrationStats) {
+    lookup_.ranks_d = IndexView("distributor_ranks_d", 0);
+    ranks_h = deviceToHost(lookup_.ranks_d);
   }
   template <typename Space>
-  Distributor<Space>::Distributor(int nr, int* rnks, MPI_Comm c) : comm(c) {
+  Distributor<Space>::Distributor(int nr, int* rnks, MPI_Comm c) : comm(c),
+                                                                   max_hops(1),
+                                                                   stats_(new MigrationStats) {
     setRanks(nr, rnks);
   }
 
   template <typename Space>
   template <typename ViewT>
-  Distributor<Space>::Distributor(ViewT rnks, MPI_Comm c) : comm(c) {
+  Distributor<Space>::Distributor(ViewT rnks, MPI_Comm c) : comm(c), max_hops(1),
+                                                            stats_(new MigrationStats) {
     setRanks(rnks);
   }
 
@@ -64,9 +233,9 @@ namespace pumipic {
   // typename std::enable_if<std::is_same<typename Space::memory_space,
   //                                      typename ViewT::memory_space>::value>::type
   void Distributor<Space>::setRanks(ViewT rnks) {
-    ranks_d = IndexView("distributor_ranks_d", rnks.size());
-    Kokkos::deep_copy(ranks_d, rnks);
-    ranks_h = deviceToHost(ranks_d);
+    lookup_.ranks_d = IndexView("distributor_ranks_d", rnks.size());
+    Kokkos::deep_copy(lookup_.ranks_d, rnks);
+    ranks_h = deviceToHost(lookup_.ranks_d);
     buildMap();
   }
 
@@ -85,41 +254,149 @@ namespace pumipic {
 
   template <typename Space>
   void Distributor<Space>::setRanks(int nr, int* rnks) {
-    ranks_d = IndexView("distributor_ranks_d", nr);
-    ranks_h = Kokkos::create_mirror_view(ranks_d);
+    lookup_.ranks_d = IndexView("distributor_ranks_d", nr);
+    ranks_h = Kokkos::create_mirror_view(lookup_.ranks_d);
     for (int i = 0; i < nr; ++i) {
       ranks_h(i) = rnks[i];
     }
-    Kokkos::deep_copy(ranks_d, ranks_h);
+    Kokkos::deep_copy(lookup_.ranks_d, ranks_h);
 
     buildMap();
   }
 
   template <typename Space>
   void Distributor<Space>::buildMap() {
-    mapping = MapType(ranks_d.size());
-    auto local_ranks = ranks_d;
-    auto& local_map = mapping;
-    auto mapConstruct = KOKKOS_LAMBDA(const int i) {
-      local_map.insert(local_ranks(i),i);
-    };
-    Kokkos::parallel_for(local_ranks.size(), mapConstruct);
+    lookup_.mapping.build(lookup_.ranks_d);
+    //The graph of the previous ranks is freed if no other copy uses it
+    graph_comm.reset();
+    lookup_.route_d = IndexView();
+    lookup_.hops_d = IndexView();
+    if (isWorld())
+      return;
+    //Neighbors are listed in index order as both sources and destinations, a self entry
+    // is a self loop so buffers indexed by Distributor::index line up with the graph
+    const int n = ranks_h.size();
+    MPI_Comm graph;
+    MPI_Dist_graph_create_adjacent(comm, n, ranks_h.data(), MPI_UNWEIGHTED,
+                                   n, ranks_h.data(), MPI_UNWEIGHTED,
+                                   MPI_INFO_NULL, 0, &graph);
+    graph_comm = makeSharedComm(graph);
+    if (max_hops > 1)
+      buildRoutes();
+  }
+
+  template <typename Space>
+  void Distributor<Space>::setMaxHops(int h) {
+    max_hops = h;
+    //The routes are only needed to forward particles
+    if (max_hops > 1 && !isWorld() && lookup_.route_d.size() == 0)
+      buildRoutes();
+  }
+
+  template <typename Space>
+  void Distributor<Space>::buildRoutes() {
+    int comm_rank, comm_size;
+    MPI_Comm_rank(comm, &comm_rank);
+    MPI_Comm_size(comm, &comm_size);
+
+    //Gather the neighborhood of every rank
+    const int n = ranks_h.size();
+    std::vector<int> degrees(comm_size);
+    MPI_Allgather(&n, 1, MPI_INT, degrees.data(), 1, MPI_INT, comm);
+    std::vector<int> displs(comm_size + 1, 0);
+    for (int i = 0; i < comm_size; ++i)
+      displs[i + 1] = displs[i] + degrees[i];
+    std::vector<int> adjacency(displs[comm_size]);
+    MPI_Allgatherv(ranks_h.data(), n, MPI_INT, adjacency.data(), degrees.data(),
+                   displs.data(), MPI_INT, comm);
+
+    //Breadth first search from this rank, every rank inherits the first hop it was found by
+    std::vector<int> hops_h(comm_size, -1), route_h(comm_size, -1);
+    std::vector<int> queue;
+    queue.reserve(comm_size);
+    hops_h[comm_rank] = 0;
+    for (int i = 0; i < n; ++i) {
+      const int rank = ranks_h(i);
+      if (rank == comm_rank)
+        route_h[rank] = i;
+      else if (hops_h[rank] == -1) {
+        hops_h[rank] = 1;
+        route_h[rank] = i;
+        queue.push_back(rank);
+      }
+    }
+    for (std::size_t q = 0; q < queue.size(); ++q) {
+      const int rank = queue[q];
+      for (int j = displs[rank]; j < displs[rank + 1]; ++j) {
+        const int next = adjacency[j];
+        if (hops_h[next] == -1) {
+          hops_h[next] = hops_h[rank] + 1;
+          route_h[next] = route_h[rank];
+          queue.push_back(next);
+        }
+      }
+    }
+
+    lookup_.route_d = IndexView("distributor_route_d", comm_size);
+    lookup_.hops_d = IndexView("distributor_hops_d", comm_size);
+    hostToDevice(lookup_.route_d, route_h.data());
+    hostToDevice(lookup_.hops_d, hops_h.data());
+  }
+
+  template <typename Space>
+  void Distributor<Space>::setNodeAware(bool on) {
+    //The previous node communicator and its window are freed if no other copy uses them
+    node_window.reset();
+    node_comm.reset();
+    node_ranks = Kokkos::View<int*, Kokkos::HostSpace>();
+    if (!on)
+      return;
+    int comm_rank, comm_size;
+    MPI_Comm_rank(comm, &comm_rank);
+    MPI_Comm_size(comm, &comm_size);
+    MPI_Comm node;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm_rank, MPI_INFO_NULL, &node);
+    node_comm = makeSharedComm(node);
+    node_window = makeSharedWindow();
+    int node_size;
+    MPI_Comm_size(node, &node_size);
+    std::vector<int> members(node_size);
+    MPI_Allgather(&comm_rank, 1, MPI_INT, members.data(), 1, MPI_INT, node);
+    node_ranks = Kokkos::View<int*, Kokkos::HostSpace>("distributor_node_ranks", comm_size);
+    Kokkos::deep_copy(node_ranks, -1);
+    for (int i = 0; i < node_size; ++i)
+      node_ranks(members[i]) = i;
+  }
+
+  template <typename Space>
+  int Distributor<Space>::nodeRank(int process) const {
+    if (!isNodeAware())
+      return -1;
+    return node_ranks(process);
+  }
+
+  template <typename Space>
+  NodeWindow& Distributor<Space>::reserveNodeWindow(std::size_t size) {
+    NodeWindow& window = *node_window;
+    if (window.win != MPI_WIN_NULL && window.size >= size)
+      return window;
+    freeNodeWindow(window);
+    window.size = size * 1.1;
+    MPI_Win_allocate_shared(window.size, 1, MPI_INFO_NULL, nodeComm(), &window.data,
+                            &window.win);
+    //Synchronization is done with messages so the window stays in a passive epoch
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window.win);
+    return window;
   }
 
   template <typename Space>
   int Distributor<Space>::num_ranks() const {
     if (!isWorld())
-      return ranks_d.size();
+      return lookup_.ranks_d.size();
     int comm_size;
     MPI_Comm_size(comm, &comm_size);
     return comm_size;
   }
-  template <typename Space>
-  PP_DEVICE int Distributor<Space>::rank(int i) const{
-    if (!isWorld())
-      return ranks_d[i];
-    return i;
-  }
 
   template <typename Space>
   int Distributor<Space>::rank_host(int i) const{
@@ -129,10 +406,14 @@ namespace pumipic {
   }
 
   template <typename Space>
-  PP_DEVICE int Distributor<Space>::index(int process) const {
+  int Distributor<Space>::index(int process) const {
     if (isWorld())
       return process;
-    return mapping.value_at(mapping.find(process));
+    const int n = ranks_h.size();
+    for (int i = 0; i < n; ++i)
+      if (ranks_h(i) == process)
+        return i;
+    return -1;
   }
 
 }
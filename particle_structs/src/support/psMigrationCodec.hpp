@@ -0,0 +1,355 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <Kokkos_Core.hpp>
+#include <ppTypes.h>
+#include <ppMacros.h>
+#include <MemberTypeLibraries.h>
+
+namespace pumipic {
+  enum MemberCodec {
+    RAW_CODEC,   //Send the member as it is stored
+    /* Send double members in single precision (lossy)
+         Note: the error grows with the magnitude of the values, about 1e-7 relative, so it
+               is not safe for positions that must stay inside their parent element
+    */
+    FLOAT_CODEC,
+    /* Send double members without their leading zero bytes after XORing them with the
+       same value of the first record of the message (lossless). Values that share their
+       sign, exponent and leading digits within a message, like positions near a part
+       boundary, shrink the most.
+    */
+    XOR_CODEC
+  };
+
+  //Bytes and time spent encoding and decoding, accumulated over migrations
+  struct MigrationCodecStats {
+    double raw_bytes;
+    double encoded_bytes;
+    double decoded_bytes;
+    double encode_seconds;
+    double decode_seconds;
+    MigrationCodecStats() : raw_bytes(0), encoded_bytes(0), decoded_bytes(0),
+                            encode_seconds(0), decode_seconds(0) {}
+    //Encoded bytes per raw byte sent (1 if nothing was encoded)
+    double ratio() const {return raw_bytes > 0 ? encoded_bytes / raw_bytes : 1;}
+    //Raw bytes encoded or decoded per second
+    double encodeThroughput() const {
+      return encode_seconds > 0 ? raw_bytes / encode_seconds : 0;
+    }
+    double decodeThroughput() const {
+      return decode_seconds > 0 ? decoded_bytes / decode_seconds : 0;
+    }
+  };
+
+  /* Encodes packed migration records before they are sent and decodes them on arrival
+
+     Each member type opts in to a codec by its index in the MemberTypes. The record
+     header and members without a codec are copied as they are. Every rank must use the
+     same codecs.
+
+     Records are encoded one message at a time. A message of n records starts with n
+     fixed size records holding the header, the raw and FLOAT_CODEC members and one byte
+     per XOR_CODEC value with its number of leading zero bytes. The remaining bytes of the
+     XOR_CODEC values follow in record order. Messages are self describing, the receiver
+     only needs their number of records and bytes. Without XOR_CODEC members every
+     message is n * recordBytes() bytes.
+
+     Note: Copies of a codec share their statistics
+   */
+  class MigrationCodec {
+  public:
+    MigrationCodec() : stats_(new MigrationCodecStats) {}
+
+    void setMemberCodec(int member, MemberCodec codec);
+    MemberCodec memberCodec(int member) const;
+    //True if no member has a codec
+    bool isRaw() const;
+    //True if the size of a message depends on its values (XOR_CODEC)
+    bool isVariable() const;
+
+    const MigrationCodecStats& stats() const {return *stats_;}
+    void resetStats() {*stats_ = MigrationCodecStats();}
+
+    //Size of the fixed part of an encoded record
+    template <typename Device, typename Header, typename DataTypes>
+    std::size_t recordBytes() const;
+    //Largest size of an encoded record, message m of a buffer starts at
+    // maxRecordBytes() * (its first record)
+    template <typename Device, typename Header, typename DataTypes>
+    std::size_t maxRecordBytes() const;
+    /* Encodes records [offsets[m], offsets[m+1]) of src into message m of dst
+         bytes - the size of each message, set on the device and copied to bytes_host
+    */
+    template <typename Device, typename Header, typename DataTypes>
+    void encode(PackedBuffer<Device> src, PackedBuffer<Device> dst, const lid_t* offsets,
+                int nmessages, Kokkos::View<lid_t*, Device> bytes,
+                typename Kokkos::View<lid_t*, Device>::HostMirror bytes_host,
+                typename Device::execution_space exec);
+    //Decodes the message of records [start, start + size) of src into the same records
+    // of dst
+    template <typename Device, typename Header, typename DataTypes>
+    void decode(PackedBuffer<Device> src, PackedBuffer<Device> dst, lid_t start, lid_t size,
+                typename Device::execution_space exec);
+
+    //A contiguous piece of a record and where it is placed in the encoded record
+    struct Segment {
+      std::size_t raw_offset;
+      std::size_t encoded_offset;
+      std::size_t bytes;
+      int codec;
+    };
+    //The header followed by one segment per member type
+    template <typename DataTypes>
+    using Segments = Kokkos::Array<Segment, DataTypes::size + 1>;
+
+    //The 8 bytes of a double as an integer, byte b of p is bits 8b to 8b+7
+    PP_INLINE static unsigned long long loadBits(const char* p) {
+      unsigned long long x = 0;
+      for (int b = 0; b < 8; ++b)
+        x |= static_cast<unsigned long long>(static_cast<unsigned char>(p[b])) << (8 * b);
+      return x;
+    }
+    PP_INLINE static void storeBits(char* p, unsigned long long x) {
+      for (int b = 0; b < 8; ++b)
+        p[b] = static_cast<char>((x >> (8 * b)) & 0xff);
+    }
+    PP_INLINE static int leadingZeroBytes(unsigned long long x) {
+      int nz = 0;
+      while (nz < 8 && ((x >> (56 - 8 * nz)) & 0xff) == 0)
+        ++nz;
+      return nz;
+    }
+    //Bytes of the XOR_CODEC values of an encoded record after its fixed part
+    template <typename DataTypes>
+    PP_INLINE static std::size_t xorBytes(const Segments<DataTypes>& segs,
+                                          const char* fixed) {
+      std::size_t bytes = 0;
+      for (int s = 0; s < DataTypes::size + 1; ++s) {
+        if (segs[s].codec != XOR_CODEC)
+          continue;
+        for (std::size_t j = 0; j < segs[s].bytes / sizeof(double); ++j)
+          bytes += 8 - fixed[segs[s].encoded_offset + j];
+      }
+      return bytes;
+    }
+  private:
+    //Kernels capture the segments by value so encoding does not allocate or copy to the
+    // device
+    template <typename Header, typename DataTypes>
+    Segments<DataTypes> segments(std::size_t& encoded_bytes) const;
+
+    std::vector<int> codecs;
+    std::shared_ptr<MigrationCodecStats> stats_;
+  };
+
+  inline void MigrationCodec::setMemberCodec(int member, MemberCodec codec) {
+    if (member >= static_cast<int>(codecs.size()))
+      codecs.resize(member + 1, RAW_CODEC);
+    codecs[member] = codec;
+  }
+
+  inline MemberCodec MigrationCodec::memberCodec(int member) const {
+    if (member >= static_cast<int>(codecs.size()))
+      return RAW_CODEC;
+    return static_cast<MemberCodec>(codecs[member]);
+  }
+
+  inline bool MigrationCodec::isRaw() const {
+    for (std::size_t i = 0; i < codecs.size(); ++i)
+      if (codecs[i] != RAW_CODEC)
+        return false;
+    return true;
+  }
+
+  inline bool MigrationCodec::isVariable() const {
+    for (std::size_t i = 0; i < codecs.size(); ++i)
+      if (codecs[i] == XOR_CODEC)
+        return true;
+    return false;
+  }
+
+  template <typename Header, typename DataTypes>
+  MigrationCodec::Segments<DataTypes>
+  MigrationCodec::segments(std::size_t& encoded_bytes) const {
+    std::vector<PackedMember> members;
+    PackedMembers<Header, DataTypes> describe(members);
+    //Encoded pieces start on 8 byte boundaries so values are read and written aligned
+    auto align = [](std::size_t offset) {return (offset + 7) / 8 * 8;};
+    Segments<DataTypes> segs;
+    segs[0].raw_offset = 0;
+    segs[0].encoded_offset = 0;
+    segs[0].bytes = sizeof(Header);
+    segs[0].codec = RAW_CODEC;
+    encoded_bytes = align(sizeof(Header));
+    for (std::size_t i = 0; i < members.size(); ++i) {
+      Segment& seg = segs[i + 1];
+      seg.raw_offset = members[i].offset;
+      seg.encoded_offset = encoded_bytes;
+      seg.bytes = members[i].bytes;
+      seg.codec = members[i].is_double ? memberCodec(i) : RAW_CODEC;
+      std::size_t size = seg.bytes;
+      if (seg.codec == FLOAT_CODEC)
+        size = seg.bytes / 2;
+      else if (seg.codec == XOR_CODEC)
+        size = seg.bytes / sizeof(double);
+      encoded_bytes = align(encoded_bytes + size);
+    }
+    return segs;
+  }
+
+  template <typename Device, typename Header, typename DataTypes>
+  std::size_t MigrationCodec::recordBytes() const {
+    std::size_t encoded_bytes;
+    segments<Header, DataTypes>(encoded_bytes);
+    return encoded_bytes;
+  }
+
+  template <typename Device, typename Header, typename DataTypes>
+  std::size_t MigrationCodec::maxRecordBytes() const {
+    std::size_t encoded_bytes;
+    const auto segs = segments<Header, DataTypes>(encoded_bytes);
+    for (int s = 0; s < DataTypes::size + 1; ++s)
+      if (segs[s].codec == XOR_CODEC)
+        encoded_bytes += segs[s].bytes;
+    return encoded_bytes;
+  }
+
+  template <typename Device, typename Header, typename DataTypes>
+  void MigrationCodec::encode(PackedBuffer<Device> src, PackedBuffer<Device> dst,
+                              const lid_t* offsets, int nmessages,
+                              Kokkos::View<lid_t*, Device> bytes,
+                              typename Kokkos::View<lid_t*, Device>::HostMirror bytes_host,
+                              typename Device::execution_space exec) {
+    typedef typename Device::execution_space ExecSpace;
+    Kokkos::Timer timer;
+    std::size_t encoded_bytes;
+    const auto segs = segments<Header, DataTypes>(encoded_bytes);
+    const std::size_t raw_bytes = PackedParticle<Header, DataTypes>::bytes;
+    const std::size_t max_bytes = maxRecordBytes<Device, Header, DataTypes>();
+    const int nsegs = segs.size();
+    Kokkos::deep_copy(exec, bytes, 0);
+    for (int m = 0; m < nmessages; ++m) {
+      const lid_t start = offsets[m];
+      const lid_t size = offsets[m + 1] - start;
+      if (size == 0)
+        continue;
+      const char* first = src.data() + static_cast<std::size_t>(start) * raw_bytes;
+      char* message = dst.data() + static_cast<std::size_t>(start) * max_bytes;
+      //The XOR_CODEC bytes of each record are placed after the bytes of the records before it
+      Kokkos::parallel_scan(Kokkos::RangePolicy<ExecSpace>(exec, 0, size),
+                            KOKKOS_LAMBDA(const lid_t& i, std::size_t& cur, const bool final) {
+        const std::size_t record = i;
+        const char* raw = first + record * raw_bytes;
+        char* encoded = message + record * encoded_bytes;
+        char* values = message + size * encoded_bytes + cur;
+        std::size_t nbytes = 0;
+        for (int s = 0; s < nsegs; ++s) {
+          const Segment seg = segs[s];
+          if (seg.codec == XOR_CODEC) {
+            for (std::size_t j = 0; j < seg.bytes / sizeof(double); ++j) {
+              unsigned long long x = loadBits(raw + seg.raw_offset + j * sizeof(double));
+              if (i > 0)
+                x ^= loadBits(first + seg.raw_offset + j * sizeof(double));
+              const int nz = leadingZeroBytes(x);
+              if (final) {
+                encoded[seg.encoded_offset + j] = nz;
+                for (int b = 0; b < 8 - nz; ++b)
+                  values[nbytes + b] = static_cast<char>((x >> (8 * b)) & 0xff);
+              }
+              nbytes += 8 - nz;
+            }
+          }
+          else if (!final)
+            continue;
+          else if (seg.codec == FLOAT_CODEC) {
+            const double* from = reinterpret_cast<const double*>(raw + seg.raw_offset);
+            float* to = reinterpret_cast<float*>(encoded + seg.encoded_offset);
+            for (std::size_t j = 0; j < seg.bytes / sizeof(double); ++j)
+              to[j] = static_cast<float>(from[j]);
+          }
+          else {
+            for (std::size_t b = 0; b < seg.bytes; ++b)
+              encoded[seg.encoded_offset + b] = raw[seg.raw_offset + b];
+          }
+        }
+        cur += nbytes;
+        if (final && i == size - 1)
+          bytes(m) = size * encoded_bytes + cur;
+      });
+    }
+    Kokkos::deep_copy(exec, bytes_host, bytes);
+    exec.fence();
+    double total = 0;
+    for (int m = 0; m < nmessages; ++m)
+      total += bytes_host(m);
+    stats_->raw_bytes += static_cast<double>(offsets[nmessages] - offsets[0]) * raw_bytes;
+    stats_->encoded_bytes += total;
+    stats_->encode_seconds += timer.seconds();
+  }
+
+  template <typename Device, typename Header, typename DataTypes>
+  void MigrationCodec::decode(PackedBuffer<Device> src, PackedBuffer<Device> dst, lid_t start,
+                              lid_t size, typename Device::execution_space exec) {
+    typedef typename Device::execution_space ExecSpace;
+    Kokkos::Timer timer;
+    std::size_t encoded_bytes;
+    const auto segs = segments<Header, DataTypes>(encoded_bytes);
+    const std::size_t raw_bytes = PackedParticle<Header, DataTypes>::bytes;
+    const std::size_t max_bytes = maxRecordBytes<Device, Header, DataTypes>();
+    const int nsegs = segs.size();
+    const char* message = src.data() + static_cast<std::size_t>(start) * max_bytes;
+    char* first = dst.data() + static_cast<std::size_t>(start) * raw_bytes;
+    Kokkos::parallel_scan(Kokkos::RangePolicy<ExecSpace>(exec, 0, size),
+                          KOKKOS_LAMBDA(const lid_t& i, std::size_t& cur, const bool final) {
+      const std::size_t record = i;
+      const char* encoded = message + record * encoded_bytes;
+      if (!final) {
+        cur += xorBytes<DataTypes>(segs, encoded);
+        return;
+      }
+      char* raw = first + record * raw_bytes;
+      const char* values = message + size * encoded_bytes + cur;
+      //The values of the first record are the start of the XOR_CODEC bytes
+      const char* first_values = message + size * encoded_bytes;
+      std::size_t nbytes = 0, first_nbytes = 0;
+      for (int s = 0; s < nsegs; ++s) {
+        const Segment seg = segs[s];
+        if (seg.codec == XOR_CODEC) {
+          for (std::size_t j = 0; j < seg.bytes / sizeof(double); ++j) {
+            const int nz = encoded[seg.encoded_offset + j];
+            unsigned long long x = 0;
+            for (int b = 0; b < 8 - nz; ++b)
+              x |= static_cast<unsigned long long>(
+                     static_cast<unsigned char>(values[nbytes + b])) << (8 * b);
+            nbytes += 8 - nz;
+            const int first_nz = message[seg.encoded_offset + j];
+            unsigned long long x0 = 0;
+            for (int b = 0; b < 8 - first_nz; ++b)
+              x0 |= static_cast<unsigned long long>(
+                      static_cast<unsigned char>(first_values[first_nbytes + b])) << (8 * b);
+            first_nbytes += 8 - first_nz;
+            if (i > 0)
+              x ^= x0;
+            storeBits(raw + seg.raw_offset + j * sizeof(double), x);
+          }
+        }
+        else if (seg.codec == FLOAT_CODEC) {
+          const float* from = reinterpret_cast<const float*>(encoded + seg.encoded_offset);
+          double* to = reinterpret_cast<double*>(raw + seg.raw_offset);
+          for (std::size_t j = 0; j < seg.bytes / sizeof(double); ++j)
+            to[j] = from[j];
+        }
+        else {
+          for (std::size_t b = 0; b < seg.bytes; ++b)
+            raw[seg.raw_offset + b] = encoded[seg.encoded_offset + b];
+        }
+      }
+      cur += nbytes;
+    });
+    exec.fence();
+    stats_->decoded_bytes += static_cast<double>(size) * raw_bytes;
+    stats_->decode_seconds += timer.seconds();
+  }
+}
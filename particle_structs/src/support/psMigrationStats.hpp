@@ -0,0 +1,114 @@
+#pragma once
+
+#include <mpi.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <ppTypes.h>
+
+namespace pumipic {
+  /* Statistics of the last migration on this process
+
+     The particle, byte and message counts are indexed by the Distributor index of each
+     neighbor. Byte counts include records copied through the on-node window. The times
+     are in seconds:
+       count_seconds - waiting for the number of particles from each neighbor
+       pack_seconds - packing and encoding the records being sent
+       wait_seconds - waiting for messages, including forwarding rounds
+       rebuild_seconds - rebuilding the structure with the received particles
+
+     toJSON reduces the statistics over a communicator to one line so a step can be logged
+     by one rank and compared between runs.
+   */
+  struct MigrationStats {
+    std::vector<lid_t> ptcls_sent;
+    std::vector<lid_t> ptcls_recv;
+    std::vector<double> bytes_sent;
+    std::vector<double> bytes_recv;
+    int messages_sent;
+    int messages_recv;
+    int rounds;
+    lid_t num_ptcls;
+    double count_seconds;
+    double pack_seconds;
+    double wait_seconds;
+    double rebuild_seconds;
+    double total_seconds;
+
+    MigrationStats() {reset(0);}
+    void reset(int num_neighbors);
+
+    lid_t totalSent() const;
+    lid_t totalRecv() const;
+    double totalBytesSent() const;
+    double totalBytesRecv() const;
+
+    //Reduces the statistics over comm (collective)
+    std::string toJSON(MPI_Comm comm) const;
+  };
+
+  inline void MigrationStats::reset(int num_neighbors) {
+    ptcls_sent.assign(num_neighbors, 0);
+    ptcls_recv.assign(num_neighbors, 0);
+    bytes_sent.assign(num_neighbors, 0);
+    bytes_recv.assign(num_neighbors, 0);
+    messages_sent = messages_recv = 0;
+    rounds = 1;
+    num_ptcls = 0;
+    count_seconds = pack_seconds = wait_seconds = rebuild_seconds = total_seconds = 0;
+  }
+
+  inline lid_t MigrationStats::totalSent() const {
+    lid_t sum = 0;
+    for (std::size_t i = 0; i < ptcls_sent.size(); ++i)
+      sum += ptcls_sent[i];
+    return sum;
+  }
+
+  inline lid_t MigrationStats::totalRecv() const {
+    lid_t sum = 0;
+    for (std::size_t i = 0; i < ptcls_recv.size(); ++i)
+      sum += ptcls_recv[i];
+    return sum;
+  }
+
+  inline double MigrationStats::totalBytesSent() const {
+    double sum = 0;
+    for (std::size_t i = 0; i < bytes_sent.size(); ++i)
+      sum += bytes_sent[i];
+    return sum;
+  }
+
+  inline double MigrationStats::totalBytesRecv() const {
+    double sum = 0;
+    for (std::size_t i = 0; i < bytes_recv.size(); ++i)
+      sum += bytes_recv[i];
+    return sum;
+  }
+
+  inline std::string MigrationStats::toJSON(MPI_Comm comm) const {
+    int comm_size;
+    MPI_Comm_size(comm, &comm_size);
+    //Totals over the ranks followed by maximums, the particle count is in both
+    const int ntotals = 4;
+    double totals[ntotals] = {static_cast<double>(totalSent()), totalBytesSent(),
+                              static_cast<double>(messages_sent),
+                              static_cast<double>(num_ptcls)};
+    const int nmaxes = 7;
+    double maxes[nmaxes] = {static_cast<double>(num_ptcls), count_seconds, pack_seconds,
+                            wait_seconds, rebuild_seconds, total_seconds,
+                            static_cast<double>(rounds)};
+    MPI_Allreduce(MPI_IN_PLACE, totals, ntotals, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, maxes, nmaxes, MPI_DOUBLE, MPI_MAX, comm);
+    const double average = totals[3] / comm_size;
+    const double imbalance = average > 0 ? maxes[0] / average : 1;
+    char line[512];
+    snprintf(line, sizeof(line), "{\"ranks\": %d, \"ptcls\": %.0f, \"ptcls_sent\": %.0f, "
+             "\"bytes_sent\": %.0f, \"messages\": %.0f, \"rounds\": %.0f, "
+             "\"imbalance\": %f, \"count_seconds\": %f, \"pack_seconds\": %f, "
+             "\"wait_seconds\": %f, \"rebuild_seconds\": %f, \"total_seconds\": %f}",
+             comm_size, totals[3], totals[0], totals[1], totals[2], maxes[6], imbalance,
+             maxes[1], maxes[2], maxes[3], maxes[4], maxes[5]);
+    return std::string(line);
+  }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <Kokkos_Core.hpp>
+#include <ppTypes.h>
+#include <ppMacros.h>
+#include <SupportKK.h>
+#ifdef PP_USE_CUDA
+#include <thrust/sort.h>
+#include <thrust/execution_policy.h>
+#endif
+
+namespace pumipic {
+  /* Static read-only index from a set of unique keys to local ids
+
+     The keys are stored sorted with their local ids alongside so a lookup is a
+     branchless binary search over a contiguous array. The index replaces
+     Kokkos::UnorderedMap for maps that do not change after they are built, such as
+     element global ids or the ranks of a Distributor.
+
+     Usage:
+       SortedIndex<gid_t, device_type> index;
+       index.build(keys);              //keys(i) maps to i
+       lid_t lid = index.find(key);    //returns -1 if key is not in the index
+   */
+  template <typename Key, typename Device>
+  class SortedIndex {
+  public:
+    typedef Kokkos::View<Key*, Device> KeyView;
+    typedef Kokkos::View<lid_t*, Device> ValueView;
+
+    SortedIndex() : num_keys(0) {}
+
+    //Build the index so that keys(i) maps to i
+    template <typename ViewT>
+    void build(ViewT keys);
+    //Build the index on the first n entries of keys on the execution space instance exec
+    template <typename ViewT, typename ExecSpace>
+    void build(ViewT keys, lid_t n, const ExecSpace& exec);
+
+    //Deep copy of an index in another memory space
+    template <typename Device2>
+    void create_copy_view(const SortedIndex<Key, Device2>& other);
+
+    PP_INLINE lid_t size() const {return num_keys;}
+    PP_INLINE lid_t find(const Key key) const;
+
+    //Sorted keys and the local id of each key
+    KeyView sorted_keys;
+    ValueView sorted_values;
+  private:
+    lid_t num_keys;
+  };
+
+  template <typename Key, typename Device>
+  template <typename ViewT>
+  void SortedIndex<Key, Device>::build(ViewT keys) {
+    build(keys, keys.size(), typename Device::execution_space());
+  }
+
+  template <typename Key, typename Device>
+  template <typename ViewT, typename ExecSpace>
+  void SortedIndex<Key, Device>::build(ViewT keys, lid_t n, const ExecSpace& exec) {
+    num_keys = n;
+    sorted_keys = KeyView("sorted_index_keys", n);
+    sorted_values = ValueView("sorted_index_values", n);
+    KeyView keys_local = sorted_keys;
+    ValueView values_local = sorted_values;
+    Kokkos::parallel_for("sorted_index_fill", Kokkos::RangePolicy<ExecSpace>(exec, 0, n),
+                         KOKKOS_LAMBDA(const lid_t& i) {
+        keys_local(i) = keys(i);
+        values_local(i) = i;
+      });
+#ifdef PP_USE_CUDA
+    thrust::sort_by_key(thrustPolicy(exec), keys_local.data(), keys_local.data() + n,
+                        values_local.data());
+    exec.fence();
+#else
+    exec.fence();
+    typename KeyView::HostMirror keys_h = deviceToHost(keys_local);
+    typename ValueView::HostMirror values_h = create_mirror_view(values_local);
+    std::vector<std::pair<Key, lid_t> > pairs(n);
+    for (lid_t i = 0; i < n; ++i)
+      pairs[i] = std::make_pair(keys_h(i), i);
+    std::sort(pairs.begin(), pairs.end());
+    for (lid_t i = 0; i < n; ++i) {
+      keys_h(i) = pairs[i].first;
+      values_h(i) = pairs[i].second;
+    }
+    Kokkos::deep_copy(keys_local, keys_h);
+    Kokkos::deep_copy(values_local, values_h);
+#endif
+  }
+
+  template <typename Key, typename Device>
+  template <typename Device2>
+  void SortedIndex<Key, Device>::create_copy_view(const SortedIndex<Key, Device2>& other) {
+    num_keys = other.size();
+    sorted_keys = KeyView("sorted_index_keys", num_keys);
+    sorted_values = ValueView("sorted_index_values", num_keys);
+    Kokkos::deep_copy(sorted_keys, other.sorted_keys);
+    Kokkos::deep_copy(sorted_values, other.sorted_values);
+  }
+
+  template <typename Key, typename Device>
+  PP_INLINE lid_t SortedIndex<Key, Device>::find(const Key key) const {
+    if (num_keys == 0)
+      return -1;
+    //Branchless lower bound: the loop trip count only depends on the number of keys
+    lid_t first = 0;
+    lid_t len = num_keys;
+    while (len > 1) {
+      const lid_t half = len / 2;
+      first += (sorted_keys(first + half - 1) < key) * half;
+      len -= half;
+    }
+    first += (sorted_keys(first) < key);
+    if (first < num_keys && sorted_keys(first) == key)
+      return sorted_values(first);
+    return -1;
+  }
+}
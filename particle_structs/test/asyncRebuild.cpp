@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <vector>
+#include <Kokkos_Core.hpp>
+
+#include <MemberTypes.h>
+#include <SellCSigma.h>
+
+#include "Distribute.h"
+
+using particle_structs::SellCSigma;
+using particle_structs::MemberTypes;
+using particle_structs::getLastValue;
+using particle_structs::lid_t;
+typedef Kokkos::DefaultExecutionSpace exe_space;
+typedef MemberTypes<int> Type;
+typedef SellCSigma<Type> SCS;
+
+/* Builds a structure on the default instance, moves every particle to the next element
+   and rebuilds. Returns true if the particles arrived.
+ */
+bool buildAndRebuild(int ne, int np, int nsteps);
+/* Builds two structures, moves each onto its own instance from partition_space with
+   setSpace and alternates rebuild and migrate between them without fencing in between.
+   Returns true if each structure kept its own particles.
+ */
+bool rebuildOnInstances(int ne, int np, int nsteps);
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  Kokkos::initialize(argc, argv);
+
+  const int ne = 100;
+  const int np = 50000;
+  const int nsteps = 5;
+  bool passed = true;
+
+  //Sequential baseline on the default instance
+  Kokkos::Timer timer;
+  for (int i = 0; i < 2; ++i) {
+    if (!buildAndRebuild(ne, np, nsteps)) {
+      passed = false;
+      printf("[ERROR] sequential rebuild %d failed\n", i);
+    }
+  }
+  const double seq_time = timer.seconds();
+
+  timer.reset();
+  if (!rebuildOnInstances(ne, np, nsteps)) {
+    passed = false;
+    printf("[ERROR] rebuilds on separate instances failed\n");
+  }
+  printf("Sequential rebuilds (seconds) %f rebuilds on separate instances (seconds) %f\n",
+         seq_time, timer.seconds());
+
+  Kokkos::finalize();
+  MPI_Finalize();
+  if (passed)
+    printf("All tests passed\n");
+  return 0;
+}
+
+bool buildAndRebuild(int ne, int np, int nsteps) {
+  int* ptcls_per_elem = new int[ne];
+  std::vector<int>* ids = new std::vector<int>[ne];
+  distribute_particles(ne, np, 0, ptcls_per_elem, ids);
+  //The policy picks up the default instance
+  Kokkos::TeamPolicy<exe_space> po(128, 4);
+  SCS::kkLidView ptcls_per_elem_v("ptcls_per_elem_v", ne);
+  SCS::kkGidView element_gids_v("element_gids_v", 0);
+  particle_structs::hostToDevice(ptcls_per_elem_v, ptcls_per_elem);
+  delete [] ptcls_per_elem;
+  delete [] ids;
+
+  SCS* scs = new SCS(po, 5, 32, ne, np, ptcls_per_elem_v, element_gids_v);
+  const exe_space exec = scs->space();
+
+  bool passed = true;
+  for (int step = 0; step < nsteps && passed; ++step) {
+    auto values = scs->get<0>();
+    SCS::kkLidView new_element("new_element", scs->capacity());
+    auto moveParticles = PS_LAMBDA(int elm_id, int ptcl_id, bool mask) {
+      if (mask) {
+        values(ptcl_id) = elm_id;
+        new_element(ptcl_id) = (elm_id + 1) % ne;
+      }
+    };
+    scs->parallel_for(moveParticles);
+    scs->rebuild(new_element);
+
+    values = scs->get<0>();
+    SCS::kkLidView fail("fail", 1);
+    auto checkParticles = PS_LAMBDA(int elm_id, int ptcl_id, bool mask) {
+      if (mask && (values(ptcl_id) + 1) % ne != elm_id)
+        fail(0) = 1;
+    };
+    scs->parallel_for(checkParticles);
+    if (getLastValue<lid_t>(fail, exec) == 1) {
+      printf("Value mismatch after rebuild %d\n", step);
+      passed = false;
+    }
+    if (scs->nPtcls() != np) {
+      printf("Particle count %d does not match %d after rebuild %d\n", scs->nPtcls(), np, step);
+      passed = false;
+    }
+  }
+  delete scs;
+  return passed;
+}
+
+bool rebuildOnInstances(int ne, int np, int nsteps) {
+  const int num_structures = 2;
+  //Distinct instances that split the resources of the default instance evenly
+  const std::vector<exe_space> instances =
+    Kokkos::Experimental::partition_space(exe_space(), 1, 1);
+
+  int* ptcls_per_elem = new int[ne];
+  std::vector<int>* ids = new std::vector<int>[ne];
+  distribute_particles(ne, np, 0, ptcls_per_elem, ids);
+  SCS::kkLidView ptcls_per_elem_v("ptcls_per_elem_v", ne);
+  SCS::kkGidView element_gids_v("element_gids_v", 0);
+  particle_structs::hostToDevice(ptcls_per_elem_v, ptcls_per_elem);
+  delete [] ptcls_per_elem;
+  delete [] ids;
+
+  SCS* scs[num_structures];
+  for (int i = 0; i < num_structures; ++i) {
+    Kokkos::TeamPolicy<exe_space> po(128, 4);
+    scs[i] = new SCS(po, 5, 32, ne, np, ptcls_per_elem_v, element_gids_v);
+  }
+  //The structures were built on the default instance
+  Kokkos::fence();
+  for (int i = 0; i < num_structures; ++i)
+    scs[i]->setSpace(instances[i]);
+
+  bool passed = true;
+  for (int step = 0; step < nsteps && passed; ++step) {
+    //Every kernel of one structure is enqueued before the next structure's
+    for (int i = 0; i < num_structures; ++i) {
+      auto values = scs[i]->get<0>();
+      SCS::kkLidView new_element("new_element", scs[i]->capacity());
+      SCS::kkLidView new_process("new_process", scs[i]->capacity());
+      const int first = i * ne;
+      auto moveParticles = PS_LAMBDA(int elm_id, int ptcl_id, bool mask) {
+        if (mask) {
+          values(ptcl_id) = first + elm_id;
+          new_element(ptcl_id) = (elm_id + 1) % ne;
+        }
+        new_process(ptcl_id) = 0;
+      };
+      scs[i]->parallel_for(moveParticles);
+      //A single rank migration rebuilds the structure
+      if (step % 2)
+        scs[i]->migrate(new_element, new_process);
+      else
+        scs[i]->rebuild(new_element);
+    }
+
+    for (int i = 0; i < num_structures; ++i) {
+      auto values = scs[i]->get<0>();
+      SCS::kkLidView fail("fail", 1);
+      const int first = i * ne;
+      auto checkParticles = PS_LAMBDA(int elm_id, int ptcl_id, bool mask) {
+        if (mask && (values(ptcl_id) < first || values(ptcl_id) >= first + ne ||
+                     (values(ptcl_id) - first + 1) % ne != elm_id))
+          fail(0) = 1;
+      };
+      scs[i]->parallel_for(checkParticles);
+      if (getLastValue<lid_t>(fail, instances[i]) == 1) {
+        printf("Value mismatch in structure %d after step %d\n", i, step);
+        passed = false;
+      }
+      if (scs[i]->nPtcls() != np) {
+        printf("Particle count %d of structure %d does not match %d after step %d\n",
+               scs[i]->nPtcls(), i, np, step);
+        passed = false;
+      }
+    }
+  }
+
+  for (int i = 0; i < num_structures; ++i) {
+    instances[i].fence();
+    delete scs[i];
+  }
+  return passed;
+}
@@ -14,7 +14,12 @@ typedef MemberTypes<int, double[3]> Type;
 typedef Kokkos::DefaultExecutionSpace exe_space;
 typedef SellCSigma<Type, exe_space> SCS;
 
-bool sendToOne(int ne, int np);
+//If node_aware is true ranks on the same node exchange particles through shared memory
+//The double member is sent with codec, FLOAT_CODEC values are checked within its error bound
+bool sendToOne(int ne, int np, bool node_aware = false,
+               particle_structs::MemberCodec codec = particle_structs::RAW_CODEC);
+//Sends particles across a ring of neighborhoods so they are forwarded through neighbors
+bool sendMultiHop(int ne, int np, bool node_aware = false);
 
 int main(int argc, char* argv[]) {
   Kokkos::initialize(argc, argv);
@@ -116,6 +121,26 @@ int main(int argc, char* argv[]) {
     printf("SendToOne failed on rank %d\n", comm_rank);
     fails++;
   }
+  if (!sendMultiHop(500, 10000)) {
+    printf("SendMultiHop failed on rank %d\n", comm_rank);
+    fails++;
+  }
+  if (!sendToOne(5000, 100000, true)) {
+    printf("Node aware SendToOne failed on rank %d\n", comm_rank);
+    fails++;
+  }
+  if (!sendToOne(5000, 100000, false, particle_structs::FLOAT_CODEC)) {
+    printf("Single precision SendToOne failed on rank %d\n", comm_rank);
+    fails++;
+  }
+  if (!sendToOne(5000, 100000, false, particle_structs::XOR_CODEC)) {
+    printf("Lossless compressed SendToOne failed on rank %d\n", comm_rank);
+    fails++;
+  }
+  if (!sendMultiHop(500, 10000, true)) {
+    printf("Node aware SendMultiHop failed on rank %d\n", comm_rank);
+    fails++;
+  }
   Kokkos::finalize();
   int total_fails;
   MPI_Reduce(&fails, &total_fails, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -125,7 +150,7 @@ int main(int argc, char* argv[]) {
   return 0;
 }
 
-bool sendToOne(int ne, int np) {
+bool sendToOne(int ne, int np, bool node_aware, particle_structs::MemberCodec codec) {
   int comm_rank;
   int comm_size;
   MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
@@ -161,7 +186,8 @@ bool sendToOne(int ne, int np) {
 
   auto setValues = PS_LAMBDA(int elem_id, int ptcl_id, int mask) {
     int_slice(ptcl_id) = comm_rank;
-    double_slice(ptcl_id,0) = comm_rank * 5;
+    //Not representable in single precision
+    double_slice(ptcl_id,0) = 1000.1 + comm_rank * 5;
     if (ptcl_id < np/100)
       new_process[ptcl_id] = 0;
     else
@@ -170,34 +196,157 @@ bool sendToOne(int ne, int np) {
   };
   scs->parallel_for(setValues);
 
-  scs->migrate(new_element, new_process);
+  particle_structs::Distributor<exe_space> dist;
+  dist.setNodeAware(node_aware);
+  dist.codec().setMemberCodec(1, codec);
+  scs->migrate(new_element, new_process, dist);
+  const particle_structs::MigrationStats& stats = dist.stats();
+  std::string step = stats.toJSON(MPI_COMM_WORLD);
+  if (comm_rank == 0)
+    printf("%s\n", step.c_str());
+  const int np_sent = comm_rank == 0 ? 0 : np / 100;
+  if (stats.totalSent() != np_sent) {
+    fprintf(stderr, "Rank %d reported %d particles sent (%d expected)\n", comm_rank,
+            stats.totalSent(), np_sent);
+    delete scs;
+    return false;
+  }
+  if (comm_rank == 0 && stats.totalRecv() != (comm_size - 1) * np / 100) {
+    fprintf(stderr, "Rank 0 reported %d particles received (%d expected)\n",
+            stats.totalRecv(), (comm_size - 1) * np / 100);
+    delete scs;
+    return false;
+  }
+  if (codec != particle_structs::RAW_CODEC && comm_rank != 0 &&
+      dist.codec().stats().ratio() >= 1) {
+    fprintf(stderr, "Rank %d did not compress the sent particles (ratio %f)\n", comm_rank,
+            dist.codec().stats().ratio());
+    delete scs;
+    return false;
+  }
 
   int nPtcls = scs->nPtcls();
   if (comm_rank == 0 && nPtcls != np + (comm_size - 1) * np * 1.0/100) {
     fprintf(stderr, "Rank 0 has incorrect number of particles (%d != %d)\n",
             nPtcls, np + (comm_size - 1) * np/100);
+    delete scs;
     return false;
   }
   else if (comm_rank != 0 && nPtcls != np*99/100) {
     fprintf(stderr, "Rank %d has incorrect number of particles (%d != %d)\n", comm_rank,
             nPtcls, np* 99/100);
+    delete scs;
     return false;
   }
 
   int_slice = scs->get<0>();
   double_slice = scs->get<1>();
   kkLidView fail("fail", 1);
+  //Single precision keeps 24 bits of the value, the other codecs are exact
+  const double tol = codec == particle_structs::FLOAT_CODEC ? 1.0 / (1 << 23) : 0;
   auto checkValues = PS_LAMBDA(int elm_id, int ptcl_id, int mask) {
     if (mask) {
       int rank = int_slice(ptcl_id);
       double val = double_slice(ptcl_id, 0);
+      const double expected = 1000.1 + rank * 5;
+      if (fabs(expected - val) > tol * fabs(expected)) {
+        printf("%d Value fails on ptcl %d (%.15f %.15f)\n", comm_rank, ptcl_id, expected, val);
+        fail(0) = 1;
+      }
+    }
+  };
+  scs->parallel_for(checkValues);
+  int f = particle_structs::getLastValue(fail);
+  delete scs;
+  return f == 0;
+}
+
+bool sendMultiHop(int ne, int np, bool node_aware) {
+  int comm_rank;
+  int comm_size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+  //Each rank neighbors itself and the ranks on either side of it
+  std::vector<int> ranks(1, comm_rank);
+  const int left = (comm_rank + comm_size - 1) % comm_size;
+  const int right = (comm_rank + 1) % comm_size;
+  if (left != comm_rank)
+    ranks.push_back(left);
+  if (right != comm_rank && right != left)
+    ranks.push_back(right);
+  particle_structs::Distributor<exe_space> dist(ranks.size(), ranks.data());
+  dist.setMaxHops(comm_size);
+  dist.setNodeAware(node_aware);
+
+  particle_structs::gid_t* gids = new particle_structs::gid_t[ne];
+  for (int i = 0; i < ne; ++i)
+    gids[i] = i;
+
+  int* ptcls_per_elem = new int[ne];
+  std::vector<int>* ids = new std::vector<int>[ne];
+  distribute_particles(ne, np, 2, ptcls_per_elem, ids);
+  delete [] ids;
+
+  SCS::kkLidView ptcls_per_elem_v("ptcls_per_elem_v", ne);
+  SCS::kkGidView element_gids_v("element_gids_v", ne);
+  particle_structs::hostToDevice(ptcls_per_elem_v, ptcls_per_elem);
+  particle_structs::hostToDevice(element_gids_v, gids);
+  delete [] ptcls_per_elem;
+  delete [] gids;
+  Kokkos::TeamPolicy<exe_space> po(4, 32);
+  SCS* scs = new SCS(po, ne, 100, ne, np, ptcls_per_elem_v, element_gids_v);
+
+  typedef SCS::kkLidView kkLidView;
+  kkLidView new_element("new_element", scs->capacity());
+  kkLidView new_process("new_process", scs->capacity());
+
+  //A tenth of the particles go to the rank across the ring
+  const int across = (comm_rank + comm_size / 2) % comm_size;
+  auto int_slice = scs->get<0>();
+  auto double_slice = scs->get<1>();
+  auto setValues = PS_LAMBDA(int elem_id, int ptcl_id, int mask) {
+    int_slice(ptcl_id) = comm_rank;
+    double_slice(ptcl_id,0) = comm_rank * 5;
+    if (ptcl_id < np/10)
+      new_process[ptcl_id] = across;
+    else
+      new_process[ptcl_id] = comm_rank;
+    new_element[ptcl_id] = elem_id;
+  };
+  scs->parallel_for(setValues);
+
+  scs->migrate(new_element, new_process, dist);
+
+  //Every rank is across the ring from exactly one rank
+  int nPtcls = scs->nPtcls();
+  if (nPtcls != np) {
+    fprintf(stderr, "Rank %d has incorrect number of particles (%d != %d)\n", comm_rank,
+            nPtcls, np);
+    delete scs;
+    return false;
+  }
+
+  const int from = (comm_rank + comm_size - comm_size / 2) % comm_size;
+  int_slice = scs->get<0>();
+  double_slice = scs->get<1>();
+  kkLidView fail("fail", 1);
+  auto checkValues = PS_LAMBDA(int elm_id, int ptcl_id, int mask) {
+    if (mask) {
+      int rank = int_slice(ptcl_id);
+      double val = double_slice(ptcl_id, 0);
+      if (rank != comm_rank && rank != from) {
+        printf("%d Origin fails on ptcl %d (%d)\n", comm_rank, ptcl_id, rank);
+        fail(0) = 1;
+      }
       if (fabs(rank*5 - val) > .0005) {
-        printf("%d Value fails on ptcl %d (%d %.2f)", comm_rank, ptcl_id, rank*5, val);
+        printf("%d Value fails on ptcl %d (%d %.2f)\n", comm_rank, ptcl_id, rank*5, val);
         fail(0) = 1;
       }
     }
   };
   scs->parallel_for(checkValues);
   int f = particle_structs::getLastValue(fail);
+  delete scs;
   return f == 0;
 }
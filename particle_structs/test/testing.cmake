@@ -10,6 +10,8 @@ add_test(NAME scs_padding COMMAND ./test_scs_padding)
 
 add_test(NAME rebuild COMMAND ./rebuild)
 
+add_test(NAME asyncRebuild COMMAND ./asyncRebuild)
+
 add_test(NAME lambdaTest COMMAND ./lambdaTest)
 
 add_test(NAME migrateNothing COMMAND ./migrateTest)
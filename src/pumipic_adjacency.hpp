@@ -7,6 +7,8 @@
 #include "Omega_h_adj.hpp"
 #include "Omega_h_element.hpp"
 #include "Omega_h_shape.hpp"
+#include "Omega_h_scan.hpp"
+#include "Omega_h_array_ops.hpp"
 
 #include <particle_structs.hpp>
 
@@ -14,6 +16,10 @@
 #include "pumipic_constants.hpp"
 #include "pumipic_kktypes.hpp"
 #include "pumipic_profiling.hpp"
+#include "pumipic_geometry.hpp"
+#include "pumipic_element_traits.hpp"
+#include "pumipic_element_grid.hpp"
+#include "pumipic_search_context.hpp"
 
 namespace o = Omega_h;
 namespace ps = particle_structs;
@@ -258,6 +264,396 @@ OMEGA_H_DEVICE o::Matrix<3, 4> gatherVectors4x3(o::Reals const& a, o::Few<o::LO,
   return o::gather_vectors<4, 3>(a, v);
 }
 
+//Returns the entries i of active with keep[i] set, in the same order
+//  The number of entries kept is read back from the end of the scan, replacing a
+//  reduction over the full particle capacity
+inline o::LOs gather_kept(o::LOs active, o::Write<o::LO> keep) {
+  const auto offsets = o::offset_scan(o::LOs(keep));
+  o::Write<o::LO> next(offsets.last(), "active_ptcls");
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    if(keep[i])
+      next[offsets[i]] = active[i];
+  }, "compact_active");
+  return next;
+}
+
+//Returns the entries of active whose particles are not done, in the same order
+inline o::LOs compact_active(o::LOs active, o::Write<o::LO> ptcl_done) {
+  o::Write<o::LO> keep(active.size(), "active_keep");
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    keep[i] = !ptcl_done[active[i]];
+  }, "mark_active");
+  return gather_kept(active, keep);
+}
+
+/* The particles that left the domain during a search, stored contiguously for surface
+   tallies. Crossing i is particle ptcls[i] leaving through exposed side faces[i] at
+   xpoints[i*dim] ... xpoints[i*dim + dim-1]. Crossings are in particle order.
+ */
+struct BoundaryCrossings {
+  o::LOs ptcls;
+  o::LOs faces;
+  o::Reals xpoints;
+  int dim;
+
+  BoundaryCrossings() : dim(0) {}
+  o::LO size() const {return ptcls.size();}
+};
+
+/* Gathers the particles in active with an exit face into a BoundaryCrossings
+     xface_ids, xpoints - the exit face and dim exit point values of every particle slot
+ */
+inline BoundaryCrossings compact_crossings(o::LOs active, o::Write<o::LO> xface_ids,
+                                           o::Write<o::Real> xpoints, const int dim) {
+  OMEGA_H_CHECK(xpoints.size() == xface_ids.size() * dim);
+  o::Write<o::LO> crossed(active.size(), "crossed");
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    crossed[i] = xface_ids[active[i]] >= 0;
+  }, "mark_crossings");
+  const auto offsets = o::offset_scan(o::LOs(crossed));
+  const auto ncrossed = offsets.last();
+  o::Write<o::LO> ptcls(ncrossed, "crossing_ptcls");
+  o::Write<o::LO> faces(ncrossed, "crossing_faces");
+  o::Write<o::Real> points(ncrossed * dim, "crossing_xpoints");
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    if(crossed[i]) {
+      const auto pid = active[i];
+      const auto c = offsets[i];
+      ptcls[c] = pid;
+      faces[c] = xface_ids[pid];
+      for(int j=0; j<dim; ++j)
+        points[c*dim + j] = xpoints[pid*dim + j];
+    }
+  }, "compact_crossings");
+  BoundaryCrossings crossings;
+  crossings.ptcls = ptcls;
+  crossings.faces = faces;
+  crossings.xpoints = points;
+  crossings.dim = dim;
+  return crossings;
+}
+
+/* Walks one particle from elm toward dest through the elements of type Elm crossed by
+   the segment from orig to dest
+
+   The side functions (barycentric coordinates for simplices) of the origin and
+   destination in the current element give the parameter where the segment crosses each
+   side. The segment leaves through the side with the smallest parameter among the
+   sides it moves toward. Parameters are compared as cross products so no division or
+   normalization is needed. Ties (the segment passes through an edge or vertex) go to
+   the side the segment crosses most steeply and then to the side with the lowest mesh
+   id, and the side a particle entered through is never its exit.
+
+   The walk stops when dest is in the element (every side function is at least -tol),
+   when it leaves through an exposed side, or after max_hops elements.
+     elm (in/out) - the element of the particle, -1 if it left the domain
+     exit_side (out) - the exposed side the particle left through, otherwise -1
+     exit_param (out) - where along the segment the particle left the domain
+     nhops (in/out) - incremented for each element visited
+   Returns true if the walk stopped before max_hops.
+ */
+template <class Elm>
+OMEGA_H_DEVICE bool walk_segment(const ElementGeometry& geom, const o::LOs& elms2sides,
+                                 const o::LOs& sides2elms,
+                                 const o::Vector<Elm::dim>& ptclOrig,
+                                 const o::Vector<Elm::dim>& ptclDest, const o::LO max_hops,
+                                 const o::Real tol, o::LO& elm, o::LO& exit_side,
+                                 o::Real& exit_param, o::LO& nhops) {
+  o::LO entrySide = -1;
+  exit_side = -1;
+  for(o::LO hop = 0; hop < max_hops; ++hop) {
+    ++nhops;
+    OMEGA_H_CHECK(elm >= 0);
+    const auto valDest = geom.sides<Elm::dim, Elm::nsides>(elm, ptclDest);
+    if(all_positive(valDest, tol))
+      return true;
+    const auto valOrig = geom.sides<Elm::dim, Elm::nsides>(elm, ptclOrig);
+    //the exit parameter is num/den
+    o::LO exitSide = -1;
+    o::Real num = 0;
+    o::Real den = 1;
+    for(int f=0; f<Elm::nsides; ++f) {
+      const auto side = elms2sides[elm*Elm::nsides + f];
+      const auto drop = valOrig[f] - valDest[f];
+      if(side == entrySide || drop <= 0)
+        continue;
+      const auto lhs = valOrig[f] * den;
+      const auto rhs = num * drop;
+      const bool tie = lhs == rhs;
+      if(exitSide == -1 || lhs < rhs ||
+         (tie && (drop > den || (drop == den && side < exitSide)))) {
+        exitSide = side;
+        num = valOrig[f];
+        den = drop;
+      }
+    }
+    //round off left no side to move toward, take the side the destination is
+    //  furthest beyond
+    if(exitSide == -1) {
+      o::Real least = 0;
+      for(int f=0; f<Elm::nsides; ++f) {
+        const auto side = elms2sides[elm*Elm::nsides + f];
+        if(side != entrySide && (exitSide == -1 || valDest[f] < least)) {
+          exitSide = side;
+          least = valDest[f];
+        }
+      }
+    }
+    const auto elmA = sides2elms[2*exitSide];
+    const auto elmB = sides2elms[2*exitSide + 1];
+    if(elmB == -1) {
+      elm = -1; //leaves domain
+      exit_side = exitSide;
+      exit_param = o::min2(o::max2(num / den, 0.0), 1.0);
+      return true;
+    }
+    elm = (elmA == elm) ? elmB : elmA;
+    entrySide = exitSide;
+  }
+  return false;
+}
+
+/* Walks each particle in active from its element toward its destination through the
+   elements of type Elm, see walk_segment
+     elem_ids (in/out) - the element of each particle, -1 if it left the domain
+     ptcl_done (out) - 1 if the particle stopped before max_hops
+     xpoints (out) - where a particle left the domain (dim values per particle), may be
+                     empty
+     xface_ids (out) - the exposed side a particle left through, otherwise -1, may be
+                       empty
+     hops (out) - the number of elements each particle visited
+     context - the search context of mesh (pumipic::Mesh::searchContext), NULL to use
+               the cached context of mesh
+ */
+template <class Elm, typename Segment>
+void element_walk(o::Mesh& mesh, o::LOs active, Segment orig, Segment dest,
+                  o::Write<o::LO> elem_ids, o::Write<o::LO> ptcl_done,
+                  o::Write<o::Real> xpoints, o::Write<o::LO> xface_ids,
+                  o::Write<o::LO> hops, o::LO max_hops, o::Real tol = EPSILON,
+                  SearchContext* context = NULL) {
+  OMEGA_H_CHECK(is_element_type<Elm>(mesh));
+  const auto& ctx = search_context(mesh, context);
+  const auto geom = ctx.geometry;
+  const auto elms2sides = ctx.elems2sides;
+  const auto sides2elms = ctx.sides2elems;
+  const bool setXpoints = xpoints.size() > 0;
+  const bool setXfaces = xface_ids.size() > 0;
+  auto walk = OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = active[i];
+    const auto ptclOrig = segmentVector<Elm::dim>(pid, orig);
+    const auto ptclDest = segmentVector<Elm::dim>(pid, dest);
+    auto elm = elem_ids[pid];
+    o::LO exitSide = -1;
+    o::Real t = 0;
+    o::LO nhops = 0;
+    const bool done = walk_segment<Elm>(geom, elms2sides, sides2elms, ptclOrig, ptclDest,
+                                        max_hops, tol, elm, exitSide, t, nhops);
+    if(setXpoints && exitSide != -1) {
+      for(int j=0; j<Elm::dim; ++j)
+        xpoints[pid*Elm::dim + j] = ptclOrig[j] + t * (ptclDest[j] - ptclOrig[j]);
+    }
+    elem_ids[pid] = elm;
+    ptcl_done[pid] = done;
+    hops[pid] = nhops;
+    if(setXfaces)
+      xface_ids[pid] = exitSide;
+  };
+  o::parallel_for(active.size(), walk, "pumipic_element_walk");
+}
+
+/* Walks each particle in active from its element through a trajectory of nwaypoints
+   points in one kernel, see walk_segment. Waypoint k of particle pid is
+   waypoints(pid, k*dim) ... waypoints(pid, k*dim + dim-1). A particle stops at its last
+   waypoint, when it leaves the domain, or when the walk to a waypoint takes max_hops
+   elements.
+     elem_ids (in/out) - the element of each particle, -1 if it left the domain
+     ptcl_done (out) - 1 if the particle stopped before max_hops
+     waypoint_elems (out) - the element of waypoint k of each particle is
+                            waypoint_elems[pid*nwaypoints + k], -1 for waypoints after
+                            the particle left the domain or was stopped, may be empty
+     xpoints (out) - where a particle left the domain on the segment it left through
+                     (dim values per particle), may be empty
+     xface_ids (out) - the exposed side a particle left through, otherwise -1, may be
+                       empty
+     hops (out) - the number of elements each particle visited
+     context - the search context of mesh, NULL to use the cached context of mesh
+ */
+template <class Elm, typename Segment, typename Trajectory>
+void trajectory_walk(o::Mesh& mesh, o::LOs active, Segment orig, Trajectory waypoints,
+                     const int nwaypoints, o::Write<o::LO> elem_ids,
+                     o::Write<o::LO> ptcl_done, o::Write<o::LO> waypoint_elems,
+                     o::Write<o::Real> xpoints, o::Write<o::LO> xface_ids,
+                     o::Write<o::LO> hops, o::LO max_hops, o::Real tol = EPSILON,
+                     SearchContext* context = NULL) {
+  OMEGA_H_CHECK(is_element_type<Elm>(mesh));
+  const auto& ctx = search_context(mesh, context);
+  const auto geom = ctx.geometry;
+  const auto elms2sides = ctx.elems2sides;
+  const auto sides2elms = ctx.sides2elems;
+  const bool setWaypoints = waypoint_elems.size() > 0;
+  const bool setXpoints = xpoints.size() > 0;
+  const bool setXfaces = xface_ids.size() > 0;
+  auto walk = OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = active[i];
+    auto ptclOrig = segmentVector<Elm::dim>(pid, orig);
+    auto elm = elem_ids[pid];
+    o::LO exitSide = -1;
+    o::Real t = 0;
+    o::LO nhops = 0;
+    bool done = true;
+    for(int k=0; k<nwaypoints; ++k) {
+      if(done && elm != -1) {
+        o::Vector<Elm::dim> ptclDest;
+        for(int j=0; j<Elm::dim; ++j)
+          ptclDest[j] = waypoints(pid, k*Elm::dim + j);
+        done = walk_segment<Elm>(geom, elms2sides, sides2elms, ptclOrig, ptclDest,
+                                 max_hops, tol, elm, exitSide, t, nhops);
+        //the exit parameter is along the segment of this waypoint
+        if(setXpoints && exitSide != -1) {
+          for(int j=0; j<Elm::dim; ++j)
+            xpoints[pid*Elm::dim + j] = ptclOrig[j] + t * (ptclDest[j] - ptclOrig[j]);
+        }
+        ptclOrig = ptclDest;
+      }
+      if(setWaypoints)
+        waypoint_elems[pid*nwaypoints + k] = done ? elm : -1;
+    }
+    elem_ids[pid] = elm;
+    ptcl_done[pid] = done;
+    hops[pid] = nhops;
+    if(setXfaces)
+      xface_ids[pid] = exitSide;
+  };
+  o::parallel_for(active.size(), walk, "pumipic_trajectory_walk");
+}
+
+/* Checks that the origin of each particle in active is in its element
+     pid_d - the particle ids printed for particles outside of their element
+     context - the search context of mesh, NULL to use the cached context of mesh
+ */
+template <class Elm, typename Segment>
+void check_origins(o::Mesh& mesh, o::LOs active, Segment orig, o::Write<o::LO> elem_ids,
+                   SegmentInt pid_d, o::Real tol, SearchContext* context = NULL) {
+  OMEGA_H_CHECK(is_element_type<Elm>(mesh));
+  const auto geom = search_context(mesh, context).geometry;
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  const auto rank_d = rank;
+  auto checkOrigin = OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = active[i];
+    const auto elm = elem_ids[pid];
+    OMEGA_H_CHECK(elm >= 0);
+    const auto ptclOrig = segmentVector<Elm::dim>(pid, orig);
+    const auto vals = geom.sides<Elm::dim, Elm::nsides>(elm, ptclOrig);
+    if(!all_positive(vals, tol)) {
+      printf("%d Particle not in element! ptcl %d elem %d orig %.15f %.15f %.15f\n",
+             rank_d, pid_d(pid), elm, ptclOrig[0], ptclOrig[1],
+             Elm::dim == 3 ? ptclOrig[Elm::dim - 1] : 0.0);
+      OMEGA_H_CHECK(false);
+    }
+  };
+  o::parallel_for(active.size(), checkOrigin, "check_origins");
+}
+
+/* Finds the element of type Elm containing each point in active without a starting
+   element
+
+   The uniform grid of the mesh elements gives the elements that may contain each
+   point, so a point in the mesh is found in O(1) expected time. Points that none of
+   their candidates contain (points outside the mesh or within round off of an element
+   boundary) walk to their position from the centroid of the element with the nearest
+   centroid.
+     pos - the points, pos(pid, d) is component d of point pid
+     elem_ids (out) - the element containing each point, -1 if it is outside the mesh
+     context - the search context of mesh, NULL to use the cached context of mesh
+   Returns the number of points outside of the mesh.
+ */
+template <class Elm, typename Segment>
+o::LO locate_points(o::Mesh& mesh, o::LOs active, Segment pos, o::Write<o::LO> elem_ids,
+                    o::Real tol = EPSILON, SearchContext* context = NULL) {
+  OMEGA_H_CHECK(is_element_type<Elm>(mesh));
+  auto& ctx = search_context(mesh, context);
+  const auto geom = ctx.geometry;
+  const auto grid = search_grid(mesh, ctx);
+  const auto capacity = elem_ids.size();
+  o::Write<o::LO> ptcl_done(capacity, 1, "locate_done");
+  auto locate = OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = active[i];
+    const auto ptcl = segmentVector<Elm::dim>(pid, pos);
+    o::Few<o::LO, Elm::dim> ijk;
+    for(int d=0; d<Elm::dim; ++d)
+      ijk[d] = grid.cellIndex(d, ptcl[d]);
+    const auto cell = grid.cellId<Elm::dim>(ijk);
+    //the lowest id of the containing elements so shared sides are assigned the same way
+    //  every run
+    o::LO found = -1;
+    for(auto j = grid.offsets[cell]; j < grid.offsets[cell+1]; ++j) {
+      const auto elm = grid.elems[j];
+      if((found == -1 || elm < found) &&
+         all_positive(geom.sides<Elm::dim, Elm::nsides>(elm, ptcl), tol))
+        found = elm;
+    }
+    elem_ids[pid] = found;
+    ptcl_done[pid] = found != -1;
+  };
+  o::parallel_for(active.size(), locate, "pumipic_locate_points");
+
+  //Walk the remaining points from nearby element centroids
+  const auto remaining = compact_active(active, ptcl_done);
+  if(remaining.size() == 0)
+    return 0;
+  typedef Kokkos::View<o::Real*[3], device_type> Points;
+  Points orig("locate_orig", capacity);
+  Points dest("locate_dest", capacity);
+  auto seed = OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = remaining[i];
+    const auto ptcl = segmentVector<Elm::dim>(pid, pos);
+    const auto elm = grid.nearestElement<Elm::dim>(ptcl);
+    for(int d=0; d<Elm::dim; ++d) {
+      orig(pid, d) = grid.centroids[elm*Elm::dim + d];
+      dest(pid, d) = ptcl[d];
+    }
+    elem_ids[pid] = elm;
+  };
+  o::parallel_for(remaining.size(), seed, "pumipic_locate_seeds");
+  o::Write<o::LO> hops(capacity, 0, "locate_hops");
+  element_walk<Elm>(mesh, remaining, orig, dest, elem_ids, ptcl_done, o::Write<o::Real>(),
+                    o::Write<o::LO>(), hops, mesh.nelems(), tol, &ctx);
+  o::Write<o::LO> outside(remaining.size(), "locate_outside");
+  o::parallel_for(remaining.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    outside[i] = elem_ids[remaining[i]] == -1;
+  }, "pumipic_locate_outside");
+  return o::get_sum(o::LOs(outside));
+}
+
+/* Search hints are a particle member the searches use to skip work on later steps. The
+   member is kept with the particle structure so it moves with the particles when they
+   are rebuilt or migrated.
+     hints(pid) = 1 - the origin of the particle was the destination of the previous
+                      search and is in the element that search located it in
+     hints(pid) = 0 - the origin has to be checked
+   Particles moved or assigned an element outside of the searches (new particles,
+   reflections) must have their hint set to 0.
+ */
+
+//Returns the particles in active whose origins are not known to be in their elements
+inline o::LOs unhinted_origins(o::LOs active, SegmentInt hints) {
+  o::Write<o::LO> keep(active.size(), "unhinted_keep");
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    keep[i] = hints(active[i]) != 1;
+  }, "mark_unhinted");
+  return gather_kept(active, keep);
+}
+
+//Sets the hints of the particles in active that were located in an element
+inline void set_search_hints(o::LOs active, o::Write<o::LO> ptcl_done,
+                             o::Write<o::LO> elem_ids, SegmentInt hints) {
+  o::parallel_for(active.size(), OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto pid = active[i];
+    hints(pid) = ptcl_done[pid] && elem_ids[pid] >= 0;
+  }, "set_search_hints");
+}
+
 //How to avoid redefining the MemberType? each application will define it
 //differently. Templating search_mesh with
 //template < typename ParticleType >
@@ -267,167 +663,56 @@ template < class ParticleType>
 bool search_mesh(o::Mesh& mesh, ps::ParticleStructure< ParticleType >* ptcls,
                  Segment3d x_ps_d, Segment3d xtgt_ps_d, SegmentInt pid_d,
                  o::Write<o::LO> elem_ids, o::Write<o::Real> xpoints_d,
-                 o::Write<o::LO> xface_id, int looplimit=0) {
-  const int debug = 0;
-
-  const auto dual = mesh.ask_dual();
-  const auto down_r2f = mesh.ask_down(3, 2);
-  const auto side_is_exposed = mark_exposed_sides(&mesh);
-  const auto mesh2verts = mesh.ask_elem_verts();
-  const auto coords = mesh.coords();
-  const auto face_verts =  mesh.ask_verts_of(2);
-  const auto down_r2fs = down_r2f.ab2b;
-  const auto dual_faces = dual.ab2b;
-  const auto dual_elems = dual.a2ab;
-
+                 o::Write<o::LO> xface_id, int looplimit=0,
+                 BoundaryCrossings* crossings=NULL, SegmentInt* hints=NULL,
+                 SearchContext* context=NULL) {
   const auto psCapacity = ptcls->capacity();
+  //The crossings are gathered from the exit points and faces so they are kept even if the
+  //  caller passed empty arrays
+  if(crossings && xface_id.size() == 0)
+    xface_id = o::Write<o::LO>(psCapacity, "xface_ids");
+  if(crossings && xpoints_d.size() == 0)
+    xpoints_d = o::Write<o::Real>(3 * psCapacity, "xpoints");
+  OMEGA_H_CHECK(xface_id.size() == 0 || xface_id.size() == psCapacity);
+  const bool setXfaces = xface_id.size() > 0;
 
   // ptcl_done[i] = 1 : particle i has hit a boundary or reached its destination
   o::Write<o::LO> ptcl_done(psCapacity, 1, "ptcl_done");
-  // particle intersection points
-  o::Write<o::Real> xpoints(3*psCapacity, 0);
-  // store the next parent for each particle
-  o::Write<o::LO> elem_ids_next(psCapacity,-1);
-  // flag to move origin if intersection fails
   auto lamb = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
     if(mask > 0) {
       elem_ids[pid] = e;
       ptcl_done[pid] = 0;
-      if (debug)
-        printf("pid %3d mask %1d elem_ids %6d\n", pid, mask, elem_ids[pid]);
     } else {
       elem_ids[pid] = -1;
       ptcl_done[pid] = 1;
     }
+    if(setXfaces)
+      xface_id[pid] = -1;
   };
   ps::parallel_for(ptcls, lamb, "init_search");
-  bool found = false;
-  int loops = 0;
-  while(!found) {
-    if(debug) {
-      fprintf(stderr, "------------ %d ------------\n", loops);
-    }
-    //pid is same for a particle between iterations in this while loop
-    auto lamb = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-      //inactive particle that is still moving to its target position
-      if( mask > 0 && !ptcl_done[pid] ) {
-        auto elmId = e;
-        auto ptcl = pid_d(pid);
-        if(debug)
-          printf("Elem %d ptcl: %d\n", elmId, ptcl);
-        if(elmId != elem_ids[pid]) {
-          elmId = elem_ids[pid];
-          if(debug)
-            printf("Switching: Elem %d ptcl: %d\n", elmId, ptcl);
-        }
-        OMEGA_H_CHECK(elmId >= 0);
-        auto tetv2v = o::gather_verts<4>(mesh2verts, elmId);
-        auto M = gatherVectors4x3(coords, tetv2v);
-        auto dest = makeVector3(pid, xtgt_ps_d);
-        auto orig = makeVector3(pid, x_ps_d);
-        Omega_h::Vector<4> bcc;
-        if(loops == 0) {
-          //make sure particle origin is in initial element
-          find_barycentric_tet(M, orig, bcc);
-          if(!all_positive(bcc, 0)) {
-            printf("ptcl %d elem %d => %d orig %.3f %.3f %.3f dest %.3f %.3f %.3f\n",
-              ptcl, e, elmId, orig[0], orig[1], orig[2], dest[0], dest[1], dest[2]);
-            printf("Particle doesn't belong to this element at loops=0");
-            OMEGA_H_CHECK(false);
-          }
-        }
-        //check if the destination is this element
-        find_barycentric_tet(M, dest, bcc);
-        if(all_positive(bcc, 0)) {
-          if(debug)
-            printf("ptcl %d is in destination elm %d\n", ptcl, elmId);
-          elem_ids_next[pid] = elem_ids[pid];
-          ptcl_done[pid] = 1;
-        } else {
-          if(debug)
-            printf("ptcl %d checking adj elms\n", ptcl);
-          //get element ID
-          auto dface_ind = dual_elems[elmId];
-          const auto beg_face = elmId *4;
-          const auto end_face = beg_face +4;
-          o::LO f_index = 0;
-          bool detected = false;
-          for(auto iface = beg_face; iface < end_face; ++iface) {
-            const auto face_id = down_r2fs[iface];
-            auto xpoint = o::zero_vector<3>();
-            bool exposed = side_is_exposed[face_id];
-            auto fv2v = o::gather_verts<3>(face_verts, face_id);
-            const auto face = gatherVectors3x3(coords, fv2v);
-            o::LO matInd1 = getfmap(f_index*2);
-            o::LO matInd2 = getfmap(f_index*2+1);
-            bool inverse = true;
-            if(fv2v[1] == tetv2v[matInd1] && fv2v[2] == tetv2v[matInd2])
-              inverse = false;
-
-            detected = line_triangle_intx_simple(face, orig, dest, xpoint, inverse);
-            if(debug)
-              printf("\t :ptcl %d faceid %d flipped %d exposed %d detected %d\n", ptcl,
-                face_id, inverse, exposed, detected);
-
-            if(detected && exposed) {
-              ptcl_done[pid] = 1;
-              for(o::LO i=0; i<3; ++i)
-                xpoints[pid*3+i] = xpoint[i];
-              elem_ids_next[pid] = -1;
-              if(debug) {
-                printf("ptcl %d faceid %d detected and exposed, next parent elm %d\n",
-                    ptcl, face_id, elem_ids_next[pid]);
-              }
-              break;
-            } else if(detected && !exposed) {
-              auto adj_elem  = dual_faces[dface_ind];
-              elem_ids_next[pid] = adj_elem;
-              if(debug) {
-                printf("ptcl %d faceid %d detected and !exposed, next parent elm %d\n",
-                    ptcl, face_id, elem_ids_next[pid]);
-              }
-              break;
-            }
-            // no line triangle intersection found for the current face
-            // appears to be a guess at the next element based on the smallest BCC
-            if(!exposed) {
-              if(debug)
-                printf("ptcl %d faceid %d !detected and !exposed\n", pid, face_id);
-              ++dface_ind;
-              const o::LO min_ind = min_index(bcc, 4);
-              if(f_index == min_ind) {
-                elem_ids_next[pid] = dual_faces[dface_ind];
-              }
-            }
-            ++f_index;
-          } //for iface
-
-        } //else not in current element
-      } //if active particle
-    };
-
-    ps::parallel_for(ptcls, lamb, "adj_search");
-
-    found = true;
-    auto cp_elm_ids = OMEGA_H_LAMBDA( o::LO i) {
-      elem_ids[i] = elem_ids_next[i];
-    };
-    o::parallel_for(elem_ids.size(), cp_elm_ids, "copy_elem_ids");
-
-    o::LOs ptcl_done_r(ptcl_done);
-    auto minFlag = o::get_min(ptcl_done_r);
-    if(minFlag == 0)
-      found = false;
-    //Copy particle data from previous to next (adjacent) element
-    ++loops;
-
-    if(looplimit && loops > looplimit) {
-      if (debug)
-        fprintf(stderr, "ERROR:loop limit %d exceeded\n", looplimit);
-      break;
-    }
+  o::LOs active = compact_active(o::LOs(psCapacity, 0, 1), ptcl_done);
+
+  //make sure particle origins are in their initial elements and walk them to their
+  //  destinations, the element type is chosen once for the whole search
+  const o::LO maxHops = looplimit ? looplimit : mesh.nelems();
+  o::Write<o::LO> hops(psCapacity, 0, "search_hops");
+  const auto unchecked = hints ? unhinted_origins(active, *hints) : active;
+  if(is_element_type<Hexahedron>(mesh)) {
+    check_origins<Hexahedron>(mesh, unchecked, x_ps_d, elem_ids, pid_d, EPSILON, context);
+    element_walk<Hexahedron>(mesh, active, x_ps_d, xtgt_ps_d, elem_ids, ptcl_done,
+                             xpoints_d, xface_id, hops, maxHops, EPSILON, context);
   }
-  return found;
+  else {
+    check_origins<Tetrahedron>(mesh, unchecked, x_ps_d, elem_ids, pid_d, EPSILON, context);
+    element_walk<Tetrahedron>(mesh, active, x_ps_d, xtgt_ps_d, elem_ids, ptcl_done,
+                              xpoints_d, xface_id, hops, maxHops, EPSILON, context);
+  }
+  if(crossings)
+    *crossings = compact_crossings(active, xface_id, xpoints_d, 3);
+  if(hints)
+    set_search_hints(active, ptcl_done, elem_ids, *hints);
+  active = compact_active(active, ptcl_done);
+  return active.size() == 0;
 }
 
 template < class ParticleStruct>
@@ -437,7 +722,10 @@ bool search_mesh_2d(o::Mesh& mesh, // (in) mesh
                  Segment3d xtgt_ps_d, // (in) target particle positions
                  SegmentInt pid_d, // (in) particle ids
                  o::Write<o::LO> elem_ids, // (out) parent element ids for the target positions
-                 int looplimit=0) {
+                 int looplimit=0, // (in) elements a particle may visit, 0 for the mesh size
+                 BoundaryCrossings* crossings=NULL, // (out) particles that left the domain, may be NULL
+                 SegmentInt* hints=NULL, // (in/out) search hints member, may be NULL
+                 SearchContext* context=NULL) { // (in) search context of mesh, may be NULL
   const auto btime = pumipic_prebarrier();
   Kokkos::Profiling::pushRegion("pumpipic_search_mesh_2d");
   Kokkos::Timer timer;
@@ -447,21 +735,10 @@ bool search_mesh_2d(o::Mesh& mesh, // (in) mesh
   MPI_Comm_size(MPI_COMM_WORLD,&comm_size);
   const auto rank_d = rank;
 
-  const auto faces2edges = mesh.ask_down(o::FACE, o::EDGE);
-  const auto edges2faces = mesh.ask_up(o::EDGE, o::FACE);
-  const auto side_is_exposed = mark_exposed_sides(&mesh);
-  const auto faces2verts = mesh.ask_elem_verts();
-  const auto coords = mesh.coords();
-  const auto edge_verts =  mesh.ask_verts_of(o::EDGE);
-  const auto faceEdges = faces2edges.ab2b;
-  const auto triArea = measure_elements_real(&mesh);
-
   const auto psCapacity = ptcls->capacity();
 
   // ptcl_done[i] = 1 : particle i has hit a boundary or reached its destination
   o::Write<o::LO> ptcl_done(psCapacity, 1, "ptcl_done");
-  // store the last crossed edge
-  o::Write<o::LO> lastEdge(psCapacity,-1);
   auto lamb = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
     if(mask > 0) {
       elem_ids[pid] = e;
@@ -472,112 +749,54 @@ bool search_mesh_2d(o::Mesh& mesh, // (in) mesh
     }
   };
   ps::parallel_for(ptcls, lamb);
-
-  auto checkParent = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-    //inactive particle that is still moving to its target position
-    if( mask > 0 && !ptcl_done[pid] ) {
+  o::LOs active = compact_active(o::LOs(psCapacity, 0, 1), ptcl_done);
+
+  //Each particle walks from element to element inside one kernel until it reaches its
+  //  destination, leaves the domain, or takes maxHops steps
+  const o::LO maxHops = looplimit ? looplimit : mesh.nelems();
+  o::Write<o::LO> hops(psCapacity, 0, "search_hops");
+  //The exit points and edges are only needed for the crossings
+  o::Write<o::Real> xpoints;
+  o::Write<o::LO> xedge_ids;
+  if(crossings) {
+    xpoints = o::Write<o::Real>(2 * psCapacity, "xpoints");
+    xedge_ids = o::Write<o::LO>(psCapacity, -1, "xedge_ids");
+  }
+  const auto unchecked = hints ? unhinted_origins(active, *hints) : active;
+  if(is_element_type<Quadrilateral>(mesh)) {
+    check_origins<Quadrilateral>(mesh, unchecked, x_ps_d, elem_ids, pid_d, 1e-8, context);
+    element_walk<Quadrilateral>(mesh, active, x_ps_d, xtgt_ps_d, elem_ids, ptcl_done,
+                                xpoints, xedge_ids, hops, maxHops, EPSILON, context);
+  }
+  else {
+    check_origins<Triangle>(mesh, unchecked, x_ps_d, elem_ids, pid_d, 1e-8, context);
+    element_walk<Triangle>(mesh, active, x_ps_d, xtgt_ps_d, elem_ids, ptcl_done,
+                           xpoints, xedge_ids, hops, maxHops, EPSILON, context);
+  }
+  if(crossings)
+    *crossings = compact_crossings(active, xedge_ids, xpoints, 2);
+  if(hints)
+    set_search_hints(active, ptcl_done, elem_ids, *hints);
+
+  //Particles that hit the hop cap
+  active = compact_active(active, ptcl_done);
+  const bool found = active.size() == 0;
+  const int loops = o::get_max(o::LOs(hops));
+  if(!found) {
+    auto ptclsNotFound = OMEGA_H_LAMBDA(const o::LO& i) {
+      const auto pid = active[i];
       auto searchElm = elem_ids[pid];
       auto ptcl = pid_d(pid);
-      OMEGA_H_CHECK(searchElm >= 0);
-      auto faceVerts = o::gather_verts<3>(faces2verts, searchElm);
-      const auto faceCoords = o::gather_vectors<3,2>(coords, faceVerts);
-      auto ptclOrigin = makeVector2(pid, x_ps_d);
-      Omega_h::Vector<3> faceBcc;
-      barycentric_tri(triArea, faceCoords, ptclOrigin, faceBcc, searchElm);
-      if(!all_positive(faceBcc,1e-8)) {
-        printf("%d Particle not in element! ptcl %d elem %d => %d "
-          "orig %.15f %.15f bcc %.3f %.3f %.3f\n",
-          rank_d, ptcl, e, searchElm, ptclOrigin[0], ptclOrigin[1],
-          faceBcc[0], faceBcc[1], faceBcc[2]);
-        OMEGA_H_CHECK(false);
-      }
-    } //if active
-  };
-  ps::parallel_for(ptcls, checkParent);
-
-  bool found = false;
-  int loops = 0;
-  while(!found) {
-    auto checkCurrentElm = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-      //active particle that is still moving to its target position
-      if( mask > 0 && !ptcl_done[pid] ) {
-        auto searchElm = elem_ids[pid];
-        auto ptcl = pid_d(pid);
-        OMEGA_H_CHECK(searchElm >= 0);
-        const auto edges = o::gather_down<3>(faceEdges, searchElm);
-        const auto faceVerts = o::gather_verts<3>(faces2verts, searchElm);
-        const auto faceCoords = o::gather_vectors<3,2>(coords, faceVerts);
-        const auto ptclDest = makeVector2(pid, xtgt_ps_d);
-        const auto ptclOrigin = makeVector2(pid, x_ps_d);
-        Omega_h::Vector<3> faceBcc;
-        barycentric_tri(triArea, faceCoords, ptclDest, faceBcc, searchElm);
-        auto isDestInParentElm = all_positive(faceBcc);
-        ptcl_done[pid] = isDestInParentElm;
-        const int idx = min3(faceBcc);
-        lastEdge[pid] = edges[idx];
-      }
-    };
-    ps::parallel_for(ptcls, checkCurrentElm);
-
-    auto checkExposedEdges = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-      if( mask > 0 && !ptcl_done[pid] ) {
-        auto searchElm = elem_ids[pid];
-        auto ptcl = pid_d(pid);
-        assert(lastEdge[pid] != -1);
-        auto bridge = lastEdge[pid];
-        auto exposed = side_is_exposed[bridge];
-        ptcl_done[pid] = exposed;
-        elem_ids[pid] = exposed ? -1 : elem_ids[pid]; //leaves domain if exposed
-      }
-    };
-    ps::parallel_for(ptcls, checkExposedEdges, "pumipic_checkExposedEdges");
-
-    auto e2f_vals = edges2faces.ab2b; // CSR value array
-    auto e2f_offsets = edges2faces.a2ab; // CSR offset array, index by mesh edge ids
-    auto setNextElm = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-      if( mask > 0 && !ptcl_done[pid] ) {
-        auto searchElm = elem_ids[pid];
-        auto ptcl = pid_d(pid);
-        auto bridge = lastEdge[pid];
-        auto e2f_first = e2f_offsets[bridge];
-        auto e2f_last = e2f_offsets[bridge+1];
-        auto upFaces = e2f_last - e2f_first;
-        assert(upFaces==2);
-        auto faceA = e2f_vals[e2f_first];
-        auto faceB = e2f_vals[e2f_first+1];
-        assert(faceA != faceB);
-        assert(faceA == searchElm || faceB == searchElm);
-        auto nextElm = (faceA == searchElm) ? faceB : faceA;
-        elem_ids[pid] = nextElm;
-      }
+      const auto ptclDest = makeVector2(pid, xtgt_ps_d);
+      const auto ptclOrigin = makeVector2(pid, x_ps_d);
+      printf("rank %d elm %d ptcl %d notFound %.15f %.15f to %.15f %.15f\n",
+          rank_d,
+          searchElm, ptcl,
+          ptclOrigin[0], ptclOrigin[1],
+          ptclDest[0], ptclDest[1]);
     };
-    ps::parallel_for(ptcls, setNextElm, "pumipic_setNextElm");
-
-    found = true;
-    o::LOs ptcl_done_r(ptcl_done);
-    auto minFlag = o::get_min(ptcl_done_r);
-    if(minFlag == 0)
-      found = false;
-    ++loops;
-
-    if(looplimit && loops >= looplimit) {
-      auto ptclsNotFound = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
-        if( mask > 0 && !ptcl_done[pid] ) {
-          auto searchElm = elem_ids[pid];
-          auto ptcl = pid_d(pid);
-          const auto ptclDest = makeVector2(pid, xtgt_ps_d);
-          const auto ptclOrigin = makeVector2(pid, x_ps_d);
-          printf("rank %d elm %d ptcl %d notFound %.15f %.15f to %.15f %.15f\n",
-              rank_d,
-              searchElm, ptcl,
-              ptclOrigin[0], ptclOrigin[1],
-              ptclDest[0], ptclDest[1]);
-        }
-      };
-      ps::parallel_for(ptcls, ptclsNotFound, "ptclsNotFound");
-      fprintf(stderr, "ERROR:loop limit %d exceeded\n", looplimit);
-      break;
-    }
+    o::parallel_for(active.size(), ptclsNotFound, "ptclsNotFound");
+    fprintf(stderr, "ERROR:loop limit %d exceeded\n", maxHops);
   }
   if(!rank || rank == comm_size/2) {
     fprintf(stderr, "%d pumipic search_2d (seconds) %f pre-barrier (seconds) %f\n",
@@ -591,5 +810,101 @@ bool search_mesh_2d(o::Mesh& mesh, // (in) mesh
   return found;
 }
 
+/* Searches for the elements of particles that move through nwaypoints points per step
+   in one call, for pushes that are sub-cycled. Waypoint k of particle pid is
+   (waypoints(pid, 2*k), waypoints(pid, 2*k+1)) and the last waypoint is its target.
+ */
+template < class ParticleStruct, typename Trajectory>
+bool search_trajectory_2d(o::Mesh& mesh, // (in) mesh
+                 ParticleStruct* ptcls, // (in) particle structure
+                 Segment3d x_ps_d, // (in) starting particle positions
+                 Trajectory waypoints, // (in) positions the particles move through
+                 const int nwaypoints, // (in) waypoints per particle
+                 SegmentInt pid_d, // (in) particle ids
+                 o::Write<o::LO> elem_ids, // (out) parent element ids for the last waypoints
+                 o::Write<o::LO> waypoint_elems=o::Write<o::LO>(), // (out) parent element ids
+                                                                  //   of each waypoint, may be empty
+                 int looplimit=0, // (in) elements a particle may visit per waypoint, 0 for the mesh size
+                 BoundaryCrossings* crossings=NULL, // (out) particles that left the domain, may be NULL
+                 SegmentInt* hints=NULL, // (in/out) search hints member, may be NULL
+                 SearchContext* context=NULL) { // (in) search context of mesh, may be NULL
+  const auto btime = pumipic_prebarrier();
+  Kokkos::Profiling::pushRegion("pumpipic_search_trajectory_2d");
+  Kokkos::Timer timer;
+
+  int rank, comm_size;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  MPI_Comm_size(MPI_COMM_WORLD,&comm_size);
+  const auto rank_d = rank;
+
+  const auto psCapacity = ptcls->capacity();
+  OMEGA_H_CHECK(waypoint_elems.size() == 0 ||
+                waypoint_elems.size() == psCapacity * nwaypoints);
+
+  // ptcl_done[i] = 1 : particle i has hit a boundary or reached its last waypoint
+  o::Write<o::LO> ptcl_done(psCapacity, 1, "ptcl_done");
+  auto lamb = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
+    if(mask > 0) {
+      elem_ids[pid] = e;
+      ptcl_done[pid] = 0;
+    } else {
+      elem_ids[pid] = -1;
+      ptcl_done[pid] = 1;
+    }
+  };
+  ps::parallel_for(ptcls, lamb);
+  o::LOs active = compact_active(o::LOs(psCapacity, 0, 1), ptcl_done);
+
+  //Each particle walks through all of its waypoints inside one kernel
+  const o::LO maxHops = looplimit ? looplimit : mesh.nelems();
+  o::Write<o::LO> hops(psCapacity, 0, "search_hops");
+  //The exit points and edges are only needed for the crossings
+  o::Write<o::Real> xpoints;
+  o::Write<o::LO> xedge_ids;
+  if(crossings) {
+    xpoints = o::Write<o::Real>(2 * psCapacity, "xpoints");
+    xedge_ids = o::Write<o::LO>(psCapacity, -1, "xedge_ids");
+  }
+  const auto unchecked = hints ? unhinted_origins(active, *hints) : active;
+  if(is_element_type<Quadrilateral>(mesh)) {
+    check_origins<Quadrilateral>(mesh, unchecked, x_ps_d, elem_ids, pid_d, 1e-8, context);
+    trajectory_walk<Quadrilateral>(mesh, active, x_ps_d, waypoints, nwaypoints, elem_ids,
+                                   ptcl_done, waypoint_elems, xpoints, xedge_ids, hops,
+                                   maxHops, EPSILON, context);
+  }
+  else {
+    check_origins<Triangle>(mesh, unchecked, x_ps_d, elem_ids, pid_d, 1e-8, context);
+    trajectory_walk<Triangle>(mesh, active, x_ps_d, waypoints, nwaypoints, elem_ids,
+                              ptcl_done, waypoint_elems, xpoints, xedge_ids, hops,
+                              maxHops, EPSILON, context);
+  }
+  if(crossings)
+    *crossings = compact_crossings(active, xedge_ids, xpoints, 2);
+  if(hints)
+    set_search_hints(active, ptcl_done, elem_ids, *hints);
+
+  //Particles that hit the hop cap
+  active = compact_active(active, ptcl_done);
+  const bool found = active.size() == 0;
+  const int loops = o::get_max(o::LOs(hops));
+  if(!found) {
+    auto ptclsNotFound = OMEGA_H_LAMBDA(const o::LO& i) {
+      const auto pid = active[i];
+      printf("rank %d elm %d ptcl %d notFound on the way to %.15f %.15f\n",
+          rank_d, elem_ids[pid], pid_d(pid),
+          waypoints(pid, 2*(nwaypoints-1)), waypoints(pid, 2*(nwaypoints-1)+1));
+    };
+    o::parallel_for(active.size(), ptclsNotFound, "ptclsNotFound");
+    fprintf(stderr, "ERROR:loop limit %d exceeded\n", maxHops);
+  }
+  if(!rank || rank == comm_size/2) {
+    fprintf(stderr, "%d pumipic search_trajectory_2d (seconds) %f pre-barrier (seconds) %f\n",
+        rank, timer.seconds(), btime);
+    fprintf(stderr, "%d pumipic search_trajectory_2d loops %d\n", rank, loops);
+  }
+  Kokkos::Profiling::popRegion();
+  return found;
+}
+
 } //namespace
 #endif //define
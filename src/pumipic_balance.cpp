@@ -0,0 +1,127 @@
+#include "pumipic_balance.hpp"
+#include <algorithm>
+#include <numeric>
+#include <mpi.h>
+#include <Omega_h_element.hpp>
+
+namespace {
+  void bisect(std::vector<Omega_h::LO>& ids, int begin, int end, int first_part, int nparts,
+              int dim, const std::vector<double>& centroids,
+              const std::vector<double>& weights, Omega_h::HostWrite<Omega_h::LO>& owners);
+}
+
+namespace pumipic {
+  ParticleBalancer::ParticleBalancer(Omega_h::Mesh& mesh, double tolerance) :
+    full_mesh(mesh), tol(tolerance) {}
+
+  Omega_h::LOs ParticleBalancer::partition(Mesh& picparts, Omega_h::LOs ptcls_per_elem) {
+    const int dim = full_mesh.dim();
+    const Omega_h::LO nelems = full_mesh.nelems();
+    MPI_Comm comm = picparts.comm()->get_impl();
+    const int comm_rank = picparts.comm()->rank();
+    const int comm_size = picparts.comm()->size();
+
+    /************* Accumulate the particles of every rank on the full mesh ************/
+    //The global ids of the full mesh and the picparts match until new picparts are built
+    Omega_h::HostRead<Omega_h::GO> full_gids(full_mesh.get_array<Omega_h::GO>(dim, "gids"));
+    Omega_h::HostRead<Omega_h::GO> part_gids(picparts.globalIds(dim));
+    Omega_h::HostRead<Omega_h::LO> loads(ptcls_per_elem);
+    //The full mesh is not partitioned so its global ids are a permutation of [0, nelems)
+    std::vector<Omega_h::LO> gid_to_full(nelems, -1);
+    for (Omega_h::LO i = 0; i < nelems; ++i) {
+      OMEGA_H_CHECK(full_gids[i] >= 0 && full_gids[i] < nelems);
+      OMEGA_H_CHECK(gid_to_full[full_gids[i]] == -1);
+      gid_to_full[full_gids[i]] = i;
+    }
+    Omega_h::HostWrite<Omega_h::LO> part_to_full(picparts.nelems(), "part_to_full");
+    std::vector<double> weights(nelems, 0);
+    for (Omega_h::LO i = 0; i < picparts.nelems(); ++i) {
+      OMEGA_H_CHECK(part_gids[i] >= 0 && part_gids[i] < nelems);
+      const Omega_h::LO full = gid_to_full[part_gids[i]];
+      part_to_full[i] = full;
+      weights[full] += loads[i];
+    }
+    elm_to_full = Omega_h::LOs(Omega_h::Write<Omega_h::LO>(part_to_full));
+    //Only the root bisects so only the root needs the total weights
+    if (comm_rank == 0)
+      MPI_Reduce(MPI_IN_PLACE, weights.data(), nelems, MPI_DOUBLE, MPI_SUM, 0, comm);
+    else
+      MPI_Reduce(weights.data(), NULL, nelems, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    /************* Bisect the element centroids on the root ************/
+    Omega_h::HostWrite<Omega_h::LO> new_owners(nelems, "balanced_owners");
+    if (comm_rank == 0) {
+      for (Omega_h::LO i = 0; i < nelems; ++i)
+        weights[i] += 1;
+      Omega_h::HostRead<Omega_h::Real> coords(full_mesh.coords());
+      Omega_h::HostRead<Omega_h::LO> elm_verts(full_mesh.ask_elem_verts());
+      const int nverts = Omega_h::element_degree(full_mesh.family(), dim, 0);
+      std::vector<double> centroids(nelems * dim, 0);
+      for (Omega_h::LO i = 0; i < nelems; ++i) {
+        for (int j = 0; j < nverts; ++j) {
+          const Omega_h::LO vtx = elm_verts[i * nverts + j];
+          for (int d = 0; d < dim; ++d)
+            centroids[i * dim + d] += coords[vtx * dim + d] / nverts;
+        }
+      }
+      std::vector<Omega_h::LO> ids(nelems);
+      std::iota(ids.begin(), ids.end(), 0);
+      bisect(ids, 0, nelems, 0, comm_size, dim, centroids, weights, new_owners);
+    }
+    MPI_Bcast(new_owners.data(), nelems, MPI_INT, 0, comm);
+    owners = Omega_h::LOs(Omega_h::Write<Omega_h::LO>(new_owners));
+    return owners;
+  }
+}
+
+namespace {
+  //Splits the elements ids[begin, end) between parts [first_part, first_part + nparts)
+  void bisect(std::vector<Omega_h::LO>& ids, int begin, int end, int first_part, int nparts,
+              int dim, const std::vector<double>& centroids,
+              const std::vector<double>& weights, Omega_h::HostWrite<Omega_h::LO>& owners) {
+    if (nparts == 1) {
+      for (int i = begin; i < end; ++i)
+        owners[ids[i]] = first_part;
+      return;
+    }
+    //Cut across the longest extent of the centroids
+    double lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    for (int d = 0; d < dim && begin < end; ++d)
+      lo[d] = hi[d] = centroids[ids[begin] * dim + d];
+    double total = 0;
+    for (int i = begin; i < end; ++i) {
+      for (int d = 0; d < dim; ++d) {
+        lo[d] = std::min(lo[d], centroids[ids[i] * dim + d]);
+        hi[d] = std::max(hi[d], centroids[ids[i] * dim + d]);
+      }
+      total += weights[ids[i]];
+    }
+    int axis = 0;
+    for (int d = 1; d < dim; ++d)
+      if (hi[d] - lo[d] > hi[axis] - lo[axis])
+        axis = d;
+    //Ties are broken by id so the partition does not depend on the sort implementation
+    std::sort(ids.begin() + begin, ids.begin() + end,
+              [&](const Omega_h::LO a, const Omega_h::LO b) {
+                const double ca = centroids[a * dim + axis];
+                const double cb = centroids[b * dim + axis];
+                return ca < cb || (ca == cb && a < b);
+              });
+
+    //Split the weight in proportion to the number of parts on each side
+    const int left_parts = nparts / 2;
+    const double target = total * left_parts / nparts;
+    int mid = begin;
+    double sum = 0;
+    while (mid < end && sum < target)
+      sum += weights[ids[mid++]];
+    //Leave at least one element for each part when possible
+    if (end - begin >= nparts)
+      mid = std::min(std::max(mid, begin + left_parts), end - (nparts - left_parts));
+    else
+      mid = begin + (end - begin) * left_parts / nparts;
+    bisect(ids, begin, mid, first_part, left_parts, dim, centroids, weights, owners);
+    bisect(ids, mid, end, first_part + left_parts, nparts - left_parts, dim, centroids,
+           weights, owners);
+  }
+}
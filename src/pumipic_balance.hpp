@@ -0,0 +1,310 @@
+#pragma once
+#include <vector>
+#include <Omega_h_mesh.hpp>
+#include <particle_structs.hpp>
+#include <psSortedIndex.hpp>
+#include "pumipic_mesh.hpp"
+
+namespace pumipic {
+  /* Particle count based load balancing of picparts
+
+     Each element of the full mesh is weighted by the number of particles in it plus one
+     for the mesh work. A new element ownership is computed by recursive coordinate bisection
+     of the element centroids. The weights are reduced to rank 0, which bisects the full
+     mesh and broadcasts the owners.
+
+     Usage:
+       ParticleBalancer balancer(full_mesh, 1.1);
+       if (balancer.needsBalance(ptcls)) {
+         Omega_h::LOs owners = balancer.partition(picparts, ptcls);
+         Mesh* balanced = new Mesh(full_mesh, owners, buffer_layers, safe_layers);
+         lid_t np = balancer.transferParticles(ptcls, *balanced, ptcls_per_elem,
+                                               particle_elements, particle_info);
+         //Construct the particle structure on balanced from the transferred particles
+       }
+     Note: partition must be called before the balanced picparts are constructed because
+           constructing picparts renumbers the global ids of the full mesh
+   */
+  class ParticleBalancer {
+  public:
+    //tolerance - largest number of particles on a rank over the average before balancing
+    ParticleBalancer(Omega_h::Mesh& full_mesh, double tolerance = 1.1);
+
+    double tolerance() const {return tol;}
+    //Returns the largest number of particles on a rank over the average
+    template <class DataTypes, typename MemSpace>
+    double imbalance(ParticleStructure<DataTypes, MemSpace>* ptcls);
+    //Returns true if the imbalance is above the tolerance
+    template <class DataTypes, typename MemSpace>
+    bool needsBalance(ParticleStructure<DataTypes, MemSpace>* ptcls) {
+      return imbalance(ptcls) > tol;
+    }
+
+    //Computes the ownership of the full mesh elements balancing the particles of ptcls
+    template <class DataTypes, typename MemSpace>
+    Omega_h::LOs partition(Mesh& picparts, ParticleStructure<DataTypes, MemSpace>* ptcls);
+    //Computes the ownership from the number of particles in each element of picparts
+    Omega_h::LOs partition(Mesh& picparts, Omega_h::LOs ptcls_per_elem);
+
+    /* Sends each particle of ptcls to the owner of its element in the last partition
+         Returns the number of particles received
+       balanced - the picparts constructed from the last partition
+       ptcls_per_elem - the number of particles in each element of balanced
+       particle_elements - the element of balanced of each particle received
+       particle_info - the member views of the particles received, destroyed by the caller
+                       with destroyViews<DataTypes, MemSpace> after the structure is built
+     */
+    template <class DataTypes, typename MemSpace>
+    lid_t transferParticles(ParticleStructure<DataTypes, MemSpace>* ptcls, Mesh& balanced,
+                            typename ParticleStructure<DataTypes, MemSpace>::kkLidView&
+                            ptcls_per_elem,
+                            typename ParticleStructure<DataTypes, MemSpace>::kkLidView&
+                            particle_elements,
+                            MemberTypeViews& particle_info);
+
+  private:
+    Omega_h::Mesh& full_mesh;
+    double tol;
+    //Owner of each element of the full mesh in the last partition
+    Omega_h::LOs owners;
+    //Element of the full mesh for each element of the partitioned picparts
+    Omega_h::LOs elm_to_full;
+  };
+
+  /* Particle-only load balancing within the buffered regions of picparts
+
+     A particle in a buffered element can be pushed by the owner of the element as well as
+     by this rank. The particles of each pair of neighbors are diffused between them by
+     changing new_process before migrate, the picparts are not changed. A rank sends
+     particles in buffered elements to their owner while it holds more particles and keeps
+     particles headed to the owner in safe buffered elements while it holds fewer.
+     Each particle still resides in exactly one picpart that contains its element, so the
+     contributions reduced by Mesh::reduceCommArray are unchanged.
+
+     The loads are only exchanged with the neighborhood of dist, which must contain the
+     buffered ranks of picparts (Distributor(picparts) does), so the cost grows with the
+     number of neighbors instead of the number of ranks. The same distributor can then be
+     passed to migrate.
+
+     rate - fraction of the load difference of each neighbor pair that is moved
+     Returns the number of particles reassigned by this rank
+   */
+  template <class DataTypes, typename MemSpace>
+  lid_t balanceBufferedParticles(Mesh& picparts, const Distributor<MemSpace>& dist,
+                                 ParticleStructure<DataTypes, MemSpace>* ptcls,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_element,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_process, double rate = 0.5);
+  //Balances over the neighborhood of Distributor(picparts)
+  template <class DataTypes, typename MemSpace>
+  lid_t balanceBufferedParticles(Mesh& picparts, ParticleStructure<DataTypes, MemSpace>* ptcls,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_element,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_process, double rate = 0.5) {
+    return balanceBufferedParticles(picparts, Distributor<MemSpace>(picparts), ptcls,
+                                    new_element, new_process, rate);
+  }
+
+  template <class DataTypes, typename MemSpace>
+  double ParticleBalancer::imbalance(ParticleStructure<DataTypes, MemSpace>* ptcls) {
+    MPI_Comm comm = full_mesh.library()->world()->get_impl();
+    long np = ptcls->nPtcls();
+    long max_np = 0, total_np = 0;
+    MPI_Allreduce(&np, &max_np, 1, MPI_LONG, MPI_MAX, comm);
+    MPI_Allreduce(&np, &total_np, 1, MPI_LONG, MPI_SUM, comm);
+    if (total_np == 0)
+      return 1;
+    const double avg = static_cast<double>(total_np) / full_mesh.library()->world()->size();
+    return max_np / avg;
+  }
+
+  template <class DataTypes, typename MemSpace>
+  Omega_h::LOs ParticleBalancer::partition(Mesh& picparts,
+                                           ParticleStructure<DataTypes, MemSpace>* ptcls) {
+    Omega_h::Write<Omega_h::LO> ptcls_per_elem(picparts.nelems(), 0, "ptcls_per_elem");
+    auto countParticles = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+      Kokkos::atomic_fetch_add(&(ptcls_per_elem[elm]), mask);
+    };
+    parallel_for(ptcls, countParticles, "countParticles");
+    return partition(picparts, Omega_h::LOs(ptcls_per_elem));
+  }
+
+  template <class DataTypes, typename MemSpace>
+  lid_t ParticleBalancer::transferParticles(ParticleStructure<DataTypes, MemSpace>* ptcls,
+                                            Mesh& balanced,
+                                            typename ParticleStructure<DataTypes, MemSpace>::
+                                            kkLidView& ptcls_per_elem,
+                                            typename ParticleStructure<DataTypes, MemSpace>::
+                                            kkLidView& particle_elements,
+                                            MemberTypeViews& particle_info) {
+    typedef ParticleStructure<DataTypes, MemSpace> PS;
+    typedef typename PS::kkLidView kkLidView;
+    typedef typename PS::kkGidView kkGidView;
+    typedef typename PS::device_type Device;
+    typedef Kokkos::RangePolicy<typename PS::execution_space> RangePolicy;
+    MPI_Comm comm = balanced.comm()->get_impl();
+    const int comm_size = balanced.comm()->size();
+    const int dim = full_mesh.dim();
+
+    /************* Find the new owner and element gid of each particle ************/
+    //The full mesh carries the global ids of the balanced picparts once they are built
+    Omega_h::GOs full_gids = full_mesh.get_array<Omega_h::GO>(dim, "gids");
+    Omega_h::LOs elm_to_full_local = elm_to_full;
+    Omega_h::LOs owners_local = owners;
+    kkLidView dest_process("dest_process", ptcls->capacity());
+    kkGidView dest_gid("dest_gid", ptcls->capacity());
+    kkLidView send_counts("send_counts", comm_size + 1);
+    auto setDestination = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+      if (mask) {
+        const Omega_h::LO full = elm_to_full_local[elm];
+        dest_process(ptcl) = owners_local[full];
+        dest_gid(ptcl) = full_gids[full];
+        Kokkos::atomic_fetch_add(&(send_counts(owners_local[full])), 1);
+      }
+    };
+    parallel_for(ptcls, setDestination, "setDestination");
+    kkLidView send_offsets("send_offsets", comm_size + 1);
+    exclusive_scan(send_counts, send_offsets);
+    typename kkLidView::HostMirror send_offsets_h = deviceToHost(send_offsets);
+
+    /************* Pack every particle behind the gid of its new element ************/
+    typedef PackedParticle<gid_t, DataTypes> Packed;
+    const std::size_t ptcl_bytes = Packed::bytes;
+    PackedBuffer<Device> send_buffer("balance_send_buffer",
+                                     send_offsets_h(comm_size) * ptcl_bytes);
+    kkLidView send_index("send_index", ptcls->capacity());
+    kkLidView cursor("cursor", comm_size + 1);
+    Kokkos::deep_copy(cursor, send_offsets);
+    auto gatherParticles = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+      if (mask) {
+        send_index(ptcl) = Kokkos::atomic_fetch_add(&(cursor(dest_process(ptcl))), 1);
+        const std::size_t index = send_index(ptcl);
+        *reinterpret_cast<gid_t*>(send_buffer.data() + index * ptcl_bytes) = dest_gid(ptcl);
+      }
+    };
+    parallel_for(ptcls, gatherParticles, "gatherParticles");
+    //No rank matches -1 so the particles staying on this rank are packed as well
+    PackParticlesToSend<PS, gid_t, DataTypes>(ptcls, send_buffer, ptcls->getMemberViews(),
+                                              dest_process, send_index, -1);
+    Kokkos::fence();
+
+    /************* Exchange the particles with every rank ************/
+    std::vector<int> send_num(comm_size), recv_num(comm_size);
+    for (int i = 0; i < comm_size; ++i)
+      send_num[i] = send_offsets_h(i + 1) - send_offsets_h(i);
+    MPI_Alltoall(send_num.data(), 1, MPI_INT, recv_num.data(), 1, MPI_INT, comm);
+    std::vector<lid_t> recv_offsets(comm_size + 1, 0);
+    for (int i = 0; i < comm_size; ++i)
+      recv_offsets[i + 1] = recv_offsets[i] + recv_num[i];
+    const lid_t np_recv = recv_offsets[comm_size];
+    PackedBuffer<Device> recv_buffer("balance_recv_buffer", np_recv * ptcl_bytes);
+    std::vector<MPI_Request> requests;
+    requests.reserve(2 * comm_size);
+    for (int i = 0; i < comm_size; ++i) {
+      if (send_num[i] > 0) {
+        requests.push_back(MPI_REQUEST_NULL);
+        PS_Comm_Isend(send_buffer, send_offsets_h(i) * ptcl_bytes, send_num[i] * ptcl_bytes,
+                      i, 0, comm, &requests.back());
+      }
+      if (recv_num[i] > 0) {
+        requests.push_back(MPI_REQUEST_NULL);
+        PS_Comm_Irecv(recv_buffer, recv_offsets[i] * ptcl_bytes, recv_num[i] * ptcl_bytes,
+                      i, 0, comm, &requests.back());
+      }
+    }
+    PS_Comm_Waitall<Device>(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    /************* Unpack the particles into the elements of balanced ************/
+    CreateViews<Device, DataTypes>(particle_info, np_recv);
+    UnpackViews<Device, gid_t, DataTypes>(particle_info, recv_buffer, 0, np_recv);
+    const lid_t ne = balanced.nelems();
+    Omega_h::GOs balanced_gids = balanced.globalIds(dim);
+    kkGidView element_gids("element_gids", ne);
+    Kokkos::parallel_for("copyElementGids", RangePolicy(0, ne), KOKKOS_LAMBDA(const lid_t& i) {
+      element_gids(i) = balanced_gids[i];
+    });
+    SortedIndex<gid_t, Device> gid_to_lid;
+    gid_to_lid.build(element_gids);
+    kkLidView ppe("ptcls_per_elem", ne);
+    kkLidView elms("particle_elements", np_recv);
+    Kokkos::parallel_for("setParticleElements", RangePolicy(0, np_recv),
+                         KOKKOS_LAMBDA(const lid_t& i) {
+      const std::size_t record = i;
+      const gid_t gid = *reinterpret_cast<const gid_t*>(recv_buffer.data() + record * ptcl_bytes);
+      const lid_t elm = gid_to_lid.find(gid);
+      elms(i) = elm;
+      Kokkos::atomic_fetch_add(&(ppe(elm)), 1);
+    });
+    ptcls_per_elem = ppe;
+    particle_elements = elms;
+    return np_recv;
+  }
+
+  template <class DataTypes, typename MemSpace>
+  lid_t balanceBufferedParticles(Mesh& picparts, const Distributor<MemSpace>& dist,
+                                 ParticleStructure<DataTypes, MemSpace>* ptcls,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_element,
+                                 typename ParticleStructure<DataTypes, MemSpace>::kkLidView
+                                 new_process, double rate) {
+    typedef typename ParticleStructure<DataTypes, MemSpace>::kkLidView kkLidView;
+    const int comm_rank = picparts.comm()->rank();
+    const int dim = picparts.dim();
+
+    //Load of each rank of the neighborhood in the index order of dist
+    const int nranks = dist.num_ranks();
+    long np = ptcls->nPtcls();
+    std::vector<long> loads(nranks);
+    if (dist.isWorld())
+      MPI_Allgather(&np, 1, MPI_LONG, loads.data(), 1, MPI_LONG, dist.mpi_comm());
+    else
+      MPI_Neighbor_allgather(&np, 1, MPI_LONG, loads.data(), 1, MPI_LONG,
+                             dist.neighbor_comm());
+
+    //Number of particles to send to or keep from each neighbor
+    kkLidView send_quota("send_quota", nranks);
+    kkLidView keep_quota("keep_quota", nranks);
+    typename kkLidView::HostMirror send_quota_h = Kokkos::create_mirror_view(send_quota);
+    typename kkLidView::HostMirror keep_quota_h = Kokkos::create_mirror_view(keep_quota);
+    for (int i = 0; i < nranks; ++i) {
+      //Both ranks of a pair compute the same flow so the flow only goes one way
+      const lid_t flow = dist.rank_host(i) == comm_rank ? 0 : rate * (np - loads[i]) / 2;
+      send_quota_h(i) = flow > 0 ? flow : 0;
+      keep_quota_h(i) = flow < 0 ? -flow : 0;
+    }
+    Kokkos::deep_copy(send_quota, send_quota_h);
+    Kokkos::deep_copy(keep_quota, keep_quota_h);
+
+    Omega_h::LOs elm_owners = picparts.entOwners(dim);
+    Omega_h::LOs is_safe = picparts.safeTag();
+    DistributorLookup<MemSpace> lookup = dist.lookup();
+    kkLidView num_reassigned("num_reassigned", 1);
+    auto reassignParticles = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+      const lid_t new_elm = new_element(ptcl);
+      if (mask && new_elm >= 0) {
+        const lid_t owner = elm_owners[new_elm];
+        const lid_t process = new_process(ptcl);
+        //Owners outside of the neighborhood are not balanced with
+        const int index = owner == comm_rank ? -1 : lookup.index(owner);
+        if (index < 0)
+          return;
+        if (process == comm_rank && send_quota(index) > 0) {
+          if (Kokkos::atomic_fetch_sub(&(send_quota(index)), 1) > 0) {
+            new_process(ptcl) = owner;
+            Kokkos::atomic_fetch_add(&(num_reassigned(0)), 1);
+          }
+        }
+        else if (process == owner && is_safe[new_elm] && keep_quota(index) > 0) {
+          if (Kokkos::atomic_fetch_sub(&(keep_quota(index)), 1) > 0) {
+            new_process(ptcl) = comm_rank;
+            Kokkos::atomic_fetch_add(&(num_reassigned(0)), 1);
+          }
+        }
+      }
+    };
+    parallel_for(ptcls, reassignParticles, "reassignParticles");
+    return getLastValue<lid_t>(num_reassigned);
+  }
+}
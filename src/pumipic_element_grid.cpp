@@ -0,0 +1,138 @@
+#include "pumipic_element_grid.hpp"
+#include "pumipic_search_context.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <Kokkos_Core.hpp>
+#include "Omega_h_bbox.hpp"
+#include "Omega_h_for.hpp"
+#include "Omega_h_element.hpp"
+#include "Omega_h_scan.hpp"
+
+namespace o = Omega_h;
+
+namespace pumipic {
+
+namespace {
+  template <int Dim>
+  void sizeGrid(o::Mesh& mesh, o::Real elems_per_cell, ElementGrid& grid) {
+    const auto box = o::get_bounding_box<Dim>(&mesh);
+    o::Real volume = 1;
+    for(int d=0; d<Dim; ++d)
+      volume *= box.max[d] - box.min[d];
+    const o::Real targetCells = std::max(mesh.nelems() / elems_per_cell, 1.0);
+    const o::Real width = std::pow(volume / targetCells, 1.0 / Dim);
+    for(int d=0; d<3; ++d) {
+      grid.lower[d] = 0;
+      grid.cellSize[d] = 1;
+      grid.ncells[d] = 1;
+    }
+    for(int d=0; d<Dim; ++d) {
+      const auto extent = box.max[d] - box.min[d];
+      grid.lower[d] = box.min[d];
+      grid.ncells[d] = width > 0 ? std::max(static_cast<o::LO>(extent / width), 1) : 1;
+      grid.cellSize[d] = extent > 0 ? extent / grid.ncells[d] : 1;
+    }
+  }
+
+  /* Lists the elements whose bounding boxes overlap each cell. The elements of a cell
+     are listed in no particular order.
+   */
+  template <int Dim>
+  void fillGrid(o::Mesh& mesh, ElementGrid& grid) {
+    const auto ne = mesh.nelems();
+    const auto nvpe = o::element_degree(mesh.family(), Dim, 0);
+    const auto elms2verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    o::LO ncells = 1;
+    for(int d=0; d<Dim; ++d)
+      ncells *= grid.ncells[d];
+    const ElementGrid g = grid;
+
+    o::Write<o::Real> centroids(ne * Dim, "pumipic_grid_centroids");
+    o::Write<o::LO> lowerCell(ne * Dim, "pumipic_grid_lower_cell");
+    o::Write<o::LO> upperCell(ne * Dim, "pumipic_grid_upper_cell");
+    o::Write<o::LO> counts(ncells, 0, "pumipic_grid_counts");
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      o::Few<o::LO, Dim> lo, hi;
+      o::LO overlaps = 1;
+      for(int d=0; d<Dim; ++d) {
+        o::Real minX = coords[elms2verts[e*nvpe]*Dim + d];
+        o::Real maxX = minX;
+        o::Real sum = 0;
+        for(int v=0; v<nvpe; ++v) {
+          const auto x = coords[elms2verts[e*nvpe + v]*Dim + d];
+          minX = x < minX ? x : minX;
+          maxX = x > maxX ? x : maxX;
+          sum += x;
+        }
+        centroids[e*Dim + d] = sum / nvpe;
+        lo[d] = g.cellIndex(d, minX);
+        hi[d] = g.cellIndex(d, maxX);
+        lowerCell[e*Dim + d] = lo[d];
+        upperCell[e*Dim + d] = hi[d];
+        overlaps *= hi[d] - lo[d] + 1;
+      }
+      for(o::LO n=0; n<overlaps; ++n) {
+        o::Few<o::LO, Dim> ijk;
+        o::LO rest = n;
+        for(int d=0; d<Dim; ++d) {
+          ijk[d] = lo[d] + rest % (hi[d] - lo[d] + 1);
+          rest /= hi[d] - lo[d] + 1;
+        }
+        Kokkos::atomic_add(&counts[g.cellId<Dim>(ijk)], 1);
+      }
+    }, "pumipic_grid_count");
+
+    const auto offsets = o::offset_scan(o::LOs(counts));
+    o::Write<o::LO> fill(ncells, 0, "pumipic_grid_fill");
+    o::Write<o::LO> elems(offsets.last(), "pumipic_grid_elems");
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      o::Few<o::LO, Dim> lo, hi;
+      o::LO overlaps = 1;
+      for(int d=0; d<Dim; ++d) {
+        lo[d] = lowerCell[e*Dim + d];
+        hi[d] = upperCell[e*Dim + d];
+        overlaps *= hi[d] - lo[d] + 1;
+      }
+      for(o::LO n=0; n<overlaps; ++n) {
+        o::Few<o::LO, Dim> ijk;
+        o::LO rest = n;
+        for(int d=0; d<Dim; ++d) {
+          ijk[d] = lo[d] + rest % (hi[d] - lo[d] + 1);
+          rest /= hi[d] - lo[d] + 1;
+        }
+        const auto cell = g.cellId<Dim>(ijk);
+        const auto slot = Kokkos::atomic_fetch_add(&fill[cell], 1);
+        elems[offsets[cell] + slot] = e;
+      }
+    }, "pumipic_grid_fill");
+    grid.offsets = offsets;
+    grid.elems = elems;
+    grid.centroids = centroids;
+  }
+}
+
+ElementGrid build_element_grid(o::Mesh& mesh, o::Real elems_per_cell) {
+  ElementGrid grid;
+  grid.coords = mesh.coords();
+  grid.nelems = mesh.nelems();
+  grid.dim = mesh.dim();
+  OMEGA_H_CHECK(grid.dim == 2 || grid.dim == 3);
+  OMEGA_H_CHECK(elems_per_cell > 0);
+  if (grid.dim == 2) {
+    sizeGrid<2>(mesh, elems_per_cell, grid);
+    fillGrid<2>(mesh, grid);
+  }
+  else {
+    sizeGrid<3>(mesh, elems_per_cell, grid);
+    fillGrid<3>(mesh, grid);
+  }
+  return grid;
+}
+
+ElementGrid const& element_grid(o::Mesh& mesh) {
+  return search_grid(mesh, search_context(mesh));
+}
+
+}
@@ -0,0 +1,121 @@
+#ifndef PUMIPIC_ELEMENT_GRID_HPP
+#define PUMIPIC_ELEMENT_GRID_HPP
+
+#include "Omega_h_mesh.hpp"
+#include "Omega_h_vector.hpp"
+
+namespace pumipic {
+
+/* Uniform grid over the bounding box of a mesh for locating points without a known
+   parent element
+
+   The box is split into about one cell per element. Each cell lists the elements whose
+   bounding boxes overlap it, so a point in the mesh is contained by one of the elements
+   of its cell. The lists are stored in CSR form:
+     the elements of cell c are elems[offsets[c]] ... elems[offsets[c+1]-1]
+   Cell c = i + ncells[0]*(j + ncells[1]*k) is the cell at index (i,j,k). Element
+   centroids are kept so the element nearest a point can be used to seed a mesh walk.
+ */
+struct ElementGrid {
+  //The coordinates the grid was computed from
+  Omega_h::Reals coords;
+  Omega_h::LOs offsets;
+  Omega_h::LOs elems;
+  Omega_h::Reals centroids;
+  Omega_h::LO nelems;
+  int dim;
+  Omega_h::Vector<3> lower;
+  Omega_h::Vector<3> cellSize;
+  Omega_h::Few<Omega_h::LO, 3> ncells;
+
+  ElementGrid() : nelems(0), dim(0) {}
+
+  //Index of the cell containing pos in direction d, points outside the box are clamped
+  //  to the nearest cell
+  OMEGA_H_DEVICE Omega_h::LO cellIndex(const int d, const Omega_h::Real pos) const {
+    const Omega_h::Real x = (pos - lower[d]) / cellSize[d];
+    if (!(x >= 0))
+      return 0;
+    return x >= ncells[d] ? ncells[d] - 1 : static_cast<Omega_h::LO>(x);
+  }
+
+  template <int D>
+  OMEGA_H_DEVICE Omega_h::LO cellId(const Omega_h::Few<Omega_h::LO, D>& ijk) const {
+    Omega_h::LO c = 0;
+    for (int d = D - 1; d >= 0; --d)
+      c = c * ncells[d] + ijk[d];
+    return c;
+  }
+
+  //Squared distance from pos to the centroid of elm
+  template <int D>
+  OMEGA_H_DEVICE Omega_h::Real centroidDistance(const Omega_h::LO elm,
+                                                const Omega_h::Vector<D>& pos) const {
+    Omega_h::Real dist = 0;
+    for (int d = 0; d < D; ++d) {
+      const auto diff = centroids[elm * D + d] - pos[d];
+      dist += diff * diff;
+    }
+    return dist;
+  }
+
+  /* The element with the nearest centroid among the elements of the nearest non-empty
+     cells to pos. Cells are visited in rings of increasing distance from the cell of
+     pos, which is not empty for points in the mesh.
+   */
+  template <int D>
+  OMEGA_H_DEVICE Omega_h::LO nearestElement(const Omega_h::Vector<D>& pos) const {
+    Omega_h::Few<Omega_h::LO, D> center;
+    Omega_h::LO maxRing = 0;
+    for (int d = 0; d < D; ++d) {
+      center[d] = cellIndex(d, pos[d]);
+      maxRing = ncells[d] > maxRing ? ncells[d] : maxRing;
+    }
+    Omega_h::LO nearest = -1;
+    Omega_h::Real nearestDist = 0;
+    for (Omega_h::LO ring = 0; ring < maxRing && nearest == -1; ++ring) {
+      //visit the cells of the cube of cells around center that are on its surface
+      Omega_h::LO ncube = 1;
+      for (int d = 0; d < D; ++d)
+        ncube *= 2 * ring + 1;
+      for (Omega_h::LO n = 0; n < ncube; ++n) {
+        Omega_h::Few<Omega_h::LO, D> ijk;
+        bool inside = true;
+        bool onSurface = false;
+        Omega_h::LO rest = n;
+        for (int d = 0; d < D; ++d) {
+          const Omega_h::LO offset = rest % (2 * ring + 1) - ring;
+          rest /= 2 * ring + 1;
+          ijk[d] = center[d] + offset;
+          inside = inside && ijk[d] >= 0 && ijk[d] < ncells[d];
+          onSurface = onSurface || offset == ring || offset == -ring;
+        }
+        if (!inside || !onSurface)
+          continue;
+        const auto cell = cellId<D>(ijk);
+        for (auto i = offsets[cell]; i < offsets[cell + 1]; ++i) {
+          const auto elm = elems[i];
+          const auto dist = centroidDistance<D>(elm, pos);
+          if (nearest == -1 || dist < nearestDist || (dist == nearestDist && elm < nearest)) {
+            nearest = elm;
+            nearestDist = dist;
+          }
+        }
+      }
+    }
+    return nearest;
+  }
+};
+
+/* Computes the grid of the elements of mesh
+     elems_per_cell - the average number of elements per cell used to size the grid
+ */
+ElementGrid build_element_grid(Omega_h::Mesh& mesh, Omega_h::Real elems_per_cell = 1);
+
+//Returns the grid of the elements of mesh kept in its search context, the grid is
+//  built on the first call
+ElementGrid const& element_grid(Omega_h::Mesh& mesh);
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PUMIPIC_ELEMENT_TRAITS_HPP
+#define PUMIPIC_ELEMENT_TRAITS_HPP
+
+#include "Omega_h_mesh.hpp"
+#include "Omega_h_element.hpp"
+#include "Omega_h_vector.hpp"
+
+namespace pumipic {
+
+/* Compile time description of an element type for the search kernels
+
+   The searches are instantiated once per element type so the loops over the vertices
+   and sides of an element have fixed trip counts. The mesh is checked against the
+   element type once before a kernel is launched, not per particle.
+
+   Each element type provides:
+     family, dim - the Omega_h family and dimension of the element
+     nverts, nsides - the number of vertices and sides (dim-1 entities)
+     name() - a readable name for messages
+
+   Note: Omega_h meshes have a single family and dimension so mixed meshes and prisms
+         are not supported. Curved (higher order) elements are located by their
+         vertices.
+ */
+template <Omega_h_Family Family, int Dim>
+struct ElementTraits {
+  static constexpr Omega_h_Family family = Family;
+  static constexpr int dim = Dim;
+  static constexpr int nverts = Family == OMEGA_H_SIMPLEX ? Dim + 1 : 1 << Dim;
+  static constexpr int nsides = Family == OMEGA_H_SIMPLEX ? Dim + 1 : 2 * Dim;
+  static const char* name();
+};
+
+typedef ElementTraits<OMEGA_H_SIMPLEX, 2> Triangle;
+typedef ElementTraits<OMEGA_H_SIMPLEX, 3> Tetrahedron;
+typedef ElementTraits<OMEGA_H_HYPERCUBE, 2> Quadrilateral;
+typedef ElementTraits<OMEGA_H_HYPERCUBE, 3> Hexahedron;
+
+template <> inline const char* Triangle::name() {return "triangle";}
+template <> inline const char* Tetrahedron::name() {return "tetrahedron";}
+template <> inline const char* Quadrilateral::name() {return "quadrilateral";}
+template <> inline const char* Hexahedron::name() {return "hexahedron";}
+
+//True if the elements of mesh are of type Elm
+template <class Elm>
+bool is_element_type(Omega_h::Mesh& mesh) {
+  return mesh.family() == Elm::family && mesh.dim() == Elm::dim;
+}
+
+//Reads the first D components of entry pid of a particle segment
+template <int D, typename Segment>
+OMEGA_H_DEVICE Omega_h::Vector<D> segmentVector(int pid, Segment xyz) {
+  Omega_h::Vector<D> v;
+  for(int i=0; i<D; ++i)
+    v[i] = xyz(pid,i);
+  return v;
+}
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "pumipic_geometry.hpp"
+#include "pumipic_constants.hpp"
+#include "pumipic_search_context.hpp"
+
+#include <Kokkos_Core.hpp>
+#include "Omega_h_for.hpp"
+#include "Omega_h_element.hpp"
+#include "Omega_h_hypercube.hpp"
+#include "Omega_h_shape.hpp"
+
+namespace o = Omega_h;
+
+namespace pumipic {
+
+namespace {
+  void buildTriPlanes(o::Mesh& mesh, o::Write<o::Real> planes) {
+    const auto ne = mesh.nelems();
+    const auto faces2verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      const auto faceVerts = o::gather_verts<3>(faces2verts, e);
+      const auto faceCoords = o::gather_vectors<3,2>(coords, faceVerts);
+      o::Few<o::Vector<2>, 2> basis;
+      basis[0] = faceCoords[1] - faceCoords[0];
+      basis[1] = faceCoords[2] - faceCoords[0];
+      const auto twiceArea = 2 * o::triangle_area_from_basis(basis);
+      //area of the triangle formed by edge i and the point over the element area
+      for(int i=0; i<3; ++i) {
+        const auto k = faceCoords[o::simplex_down_template(o::FACE, o::EDGE, i, 0)];
+        const auto l = faceCoords[o::simplex_down_template(o::FACE, o::EDGE, i, 1)];
+        const auto first = i * 3 * ne + e;
+        planes[first] = -(l[1] - k[1]) / twiceArea;
+        planes[first + ne] = (l[0] - k[0]) / twiceArea;
+        planes[first + 2 * ne] = ((l[1] - k[1]) * k[0] - (l[0] - k[0]) * k[1]) / twiceArea;
+      }
+    }, "pumipic_tri_planes");
+  }
+
+  void buildTetPlanes(o::Mesh& mesh, o::Write<o::Real> planes) {
+    const auto ne = mesh.nelems();
+    const auto tets2verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      const auto tetVerts = o::gather_verts<4>(tets2verts, e);
+      const auto M = o::gather_vectors<4,3>(coords, tetVerts);
+      o::Few<o::Vector<3>, 3> abc;
+      //six times the volume using the bottom face as find_barycentric_tet does
+      for(int j=0; j<3; ++j)
+        abc[j] = M[o::simplex_down_template(3, 2, 0, j)];
+      const auto vol6 = o::inner_product(M[3] - M[0],
+                                         o::cross(abc[2] - abc[0], abc[1] - abc[0]));
+      for(int iface=0; iface<4; ++iface) {
+        const auto first = iface * 4 * ne + e;
+        if(vol6 <= EPSILON) {
+          for(int j=0; j<3; ++j)
+            planes[first + j * ne] = 0;
+          planes[first + 3 * ne] = -1;
+          continue;
+        }
+        for(int j=0; j<3; ++j)
+          abc[j] = M[o::simplex_down_template(3, 2, iface, j)];
+        const auto normal = o::cross(abc[2] - abc[0], abc[1] - abc[0]);
+        for(int j=0; j<3; ++j)
+          planes[first + j * ne] = normal[j] / vol6;
+        planes[first + 3 * ne] = -o::inner_product(normal, abc[0]) / vol6;
+      }
+    }, "pumipic_tet_planes");
+  }
+
+  //Side functions of quads and hexes are signed distances to a plane through the side
+  //  center oriented toward the element center
+  template <int Dim>
+  OMEGA_H_DEVICE void setSidePlane(o::Write<o::Real> planes, o::LO ne, o::LO e, int side,
+                                   o::Vector<Dim> normal, o::Vector<Dim> center,
+                                   o::Vector<Dim> elmCenter) {
+    normal = o::normalize(normal);
+    if(o::inner_product(normal, elmCenter - center) < 0)
+      normal = -normal;
+    const auto first = side * (Dim + 1) * ne + e;
+    for(int j=0; j<Dim; ++j)
+      planes[first + j * ne] = normal[j];
+    planes[first + Dim * ne] = -o::inner_product(normal, center);
+  }
+
+  void buildQuadPlanes(o::Mesh& mesh, o::Write<o::Real> planes) {
+    const auto ne = mesh.nelems();
+    const auto quads2verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      const auto X = o::gather_vectors<4,2>(coords, o::gather_verts<4>(quads2verts, e));
+      const auto elmCenter = (X[0] + X[1] + X[2] + X[3]) / 4.0;
+      for(int side=0; side<4; ++side) {
+        const auto a = X[o::hypercube_down_template(2, 1, side, 0)];
+        const auto b = X[o::hypercube_down_template(2, 1, side, 1)];
+        const o::Vector<2> normal{a[1] - b[1], b[0] - a[0]};
+        setSidePlane<2>(planes, ne, e, side, normal, (a + b) / 2.0, elmCenter);
+      }
+    }, "pumipic_quad_planes");
+  }
+
+  void buildHexPlanes(o::Mesh& mesh, o::Write<o::Real> planes) {
+    const auto ne = mesh.nelems();
+    const auto hexes2verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+      const auto X = o::gather_vectors<8,3>(coords, o::gather_verts<8>(hexes2verts, e));
+      auto elmCenter = o::zero_vector<3>();
+      for(int v=0; v<8; ++v)
+        elmCenter = elmCenter + X[v] / 8.0;
+      for(int side=0; side<6; ++side) {
+        o::Few<o::Vector<3>, 4> q;
+        for(int j=0; j<4; ++j)
+          q[j] = X[o::hypercube_down_template(3, 2, side, j)];
+        //the diagonals of a warped face span its best fit plane
+        const auto normal = o::cross(q[2] - q[0], q[3] - q[1]);
+        setSidePlane<3>(planes, ne, e, side, normal, (q[0] + q[1] + q[2] + q[3]) / 4.0,
+                        elmCenter);
+      }
+    }, "pumipic_hex_planes");
+  }
+}
+
+ElementGeometry build_element_geometry(o::Mesh& mesh) {
+  ElementGeometry geom;
+  geom.coords = mesh.coords();
+  geom.nelems = mesh.nelems();
+  geom.dim = mesh.dim();
+  geom.nsides = o::element_degree(mesh.family(), geom.dim, geom.dim - 1);
+  OMEGA_H_CHECK(geom.dim == 2 || geom.dim == 3);
+  o::Write<o::Real> planes(geom.nsides * (geom.dim + 1) * geom.nelems,
+                           "pumipic_element_planes");
+  const bool simplex = mesh.family() == OMEGA_H_SIMPLEX;
+  if (geom.dim == 2 && simplex)
+    buildTriPlanes(mesh, planes);
+  else if (geom.dim == 2)
+    buildQuadPlanes(mesh, planes);
+  else if (simplex)
+    buildTetPlanes(mesh, planes);
+  else
+    buildHexPlanes(mesh, planes);
+  geom.planes = planes;
+  return geom;
+}
+
+ElementGeometry const& element_geometry(o::Mesh& mesh) {
+  return search_context(mesh).geometry;
+}
+
+}
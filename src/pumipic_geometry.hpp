@@ -0,0 +1,67 @@
+#ifndef PUMIPIC_GEOMETRY_HPP
+#define PUMIPIC_GEOMETRY_HPP
+
+#include "Omega_h_mesh.hpp"
+#include "Omega_h_vector.hpp"
+
+namespace pumipic {
+
+/* Precomputed geometry of the elements of a mesh for point location
+
+   Each side of an element has an affine function of a point that is non-negative on
+   the element's side of it. For each element the coefficients of those functions are
+   stored so a point-in-element test is nsides*(dim+1) fused multiply-adds. The
+   coefficients are stored component major so threads reading the same coefficient of
+   nearby elements load contiguous memory:
+     coefficient k of side i of element e is planes[(i*(dim+1) + k)*nelems + e]
+   For each side the coefficients are the dim gradient terms followed by the constant
+   term.
+
+   For simplices the functions are the barycentric coordinates ordered to match
+   barycentric_tri (by the edges of a triangle) and find_barycentric_tet (by the faces
+   of a tet), so the smallest value gives the side the point is beyond. Degenerate tets
+   have every coordinate at -1. For quads and hexes the functions are the distances to
+   the (planar fit of each) side.
+ */
+struct ElementGeometry {
+  //The coordinates the geometry was computed from
+  Omega_h::Reals coords;
+  Omega_h::Reals planes;
+  Omega_h::LO nelems;
+  int dim;
+  int nsides;
+
+  ElementGeometry() : nelems(0), dim(0), nsides(0) {}
+
+  //Values of the side functions of element elm at pos
+  template <int D, int NS>
+  OMEGA_H_DEVICE Omega_h::Vector<NS> sides(const Omega_h::LO elm,
+                                           const Omega_h::Vector<D>& pos) const {
+    Omega_h::Vector<NS> vals;
+    for (int i = 0; i < NS; ++i) {
+      const Omega_h::LO first = (i * (D + 1)) * nelems + elm;
+      Omega_h::Real v = planes[first + D * nelems];
+      for (int j = 0; j < D; ++j)
+        v += planes[first + j * nelems] * pos[j];
+      vals[i] = v;
+    }
+    return vals;
+  }
+
+  //Barycentric coordinates of pos in the simplex elm
+  template <int D>
+  OMEGA_H_DEVICE Omega_h::Vector<D+1> barycentric(const Omega_h::LO elm,
+                                                  const Omega_h::Vector<D>& pos) const {
+    return sides<D, D+1>(elm, pos);
+  }
+};
+
+//Computes the geometry of the elements of mesh
+ElementGeometry build_element_geometry(Omega_h::Mesh& mesh);
+
+//Returns the geometry of the elements of mesh kept in its search context
+ElementGeometry const& element_geometry(Omega_h::Mesh& mesh);
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 
 namespace pumipic {
   Mesh::~Mesh() {
+    //The picpart may also have been searched without the context of the picparts
+    release_search_context(*picpart);
     if (!isFullMesh())
       delete picpart;
   }
@@ -2,6 +2,8 @@
 #include <Omega_h_mesh.hpp>
 #include "pumipic_library.hpp"
 #include "pumipic_input.hpp"
+#include "pumipic_search_context.hpp"
+#include <psDistributor.hpp>
 
 namespace pumipic {
   class Mesh {
@@ -35,6 +37,8 @@ namespace pumipic {
     Omega_h::LO nelems() const {return picpart->nelems();}
     //Returns the commptr
     Omega_h::CommPtr comm() const {return commptr;}
+    //Returns the arrays the particle searches read, pass it to the searches of the picpart
+    SearchContext& searchContext() {return update_search_context(*picpart, search_ctx);}
 
     //Returns the number of parts buffered (includes self in count)
     int numBuffers(int dim) const {return num_cores[dim] + 1;}
@@ -86,6 +90,8 @@ namespace pumipic {
   private:
     Omega_h::CommPtr commptr;
     Omega_h::Mesh* picpart;
+    //Arrays of the picpart read by the searches
+    SearchContext search_ctx;
 
     bool is_full_mesh;
 
@@ -121,4 +127,19 @@ namespace pumipic {
     //The entities to send to each part for boundary
     Omega_h::LOs bounded_ent_ids[4];
   };
+
+  //Neighborhood of this part followed by the parts buffered in its elements
+  template <typename Space>
+  Distributor<Space>::Distributor(Mesh& picparts) : comm(picparts.comm()->get_impl()),
+                                                    max_hops(1),
+                                                    stats_(new MigrationStats) {
+    const int dim = picparts.dim();
+    const int nbuffers = picparts.numBuffers(dim);
+    Omega_h::HostWrite<Omega_h::LO> buffers = picparts.bufferedRanks(dim);
+    std::vector<int> ranks(nbuffers);
+    ranks[0] = picparts.comm()->rank();
+    for (int i = 0; i < nbuffers - 1; ++i)
+      ranks[i + 1] = buffers[i];
+    setRanks(nbuffers, ranks.data());
+  }
 }
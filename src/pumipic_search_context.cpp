@@ -0,0 +1,110 @@
+#include "pumipic_search_context.hpp"
+
+#include <map>
+#include <mutex>
+#include <Kokkos_Core.hpp>
+#include "Omega_h_for.hpp"
+#include "Omega_h_element.hpp"
+
+namespace o = Omega_h;
+
+namespace pumipic {
+
+namespace {
+  o::LOs buildSides2Elems(o::Mesh& mesh) {
+    const auto nsides = mesh.nents(mesh.dim() - 1);
+    const auto sides2elms = mesh.ask_up(mesh.dim() - 1, mesh.dim());
+    const auto offsets = sides2elms.a2ab;
+    const auto elms = sides2elms.ab2b;
+    o::Write<o::LO> sides2elems(2 * nsides, "pumipic_sides2elems");
+    o::parallel_for(nsides, OMEGA_H_LAMBDA(const o::LO& s) {
+      const auto first = offsets[s];
+      const auto count = offsets[s + 1] - first;
+      sides2elems[2 * s] = elms[first];
+      sides2elems[2 * s + 1] = count == 2 ? elms[first + 1] : -1;
+    }, "pumipic_sides2elems");
+    return sides2elems;
+  }
+
+  //Contexts of the meshes searched without a context, stamped with their last use
+  struct CachedContext {
+    SearchContext ctx;
+    unsigned long last_use;
+    CachedContext() : last_use(0) {}
+  };
+  typedef std::map<o::Mesh*, CachedContext> ContextCache;
+  const std::size_t max_cached_contexts = 8;
+  //Guards the entries of the cache, not the contexts in them
+  std::mutex cache_mutex;
+
+  ContextCache& context_cache() {
+    static ContextCache cache;
+    //The arrays must be deallocated before Kokkos is, the hook is registered once by the
+    //  thread-safe initialization of the static
+    static const bool hooked = []() {
+      Kokkos::push_finalize_hook([]() {context_cache().clear();});
+      return true;
+    }();
+    (void)hooked;
+    return cache;
+  }
+
+  //Evicts the least recently used context other than keep
+  void evict_context(ContextCache& cache, o::Mesh* keep) {
+    auto oldest = cache.end();
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+      if (it->first != keep && (oldest == cache.end() ||
+                                it->second.last_use < oldest->second.last_use))
+        oldest = it;
+    }
+    if (oldest != cache.end())
+      cache.erase(oldest);
+  }
+}
+
+SearchContext build_search_context(o::Mesh& mesh) {
+  SearchContext ctx;
+  ctx.coords = mesh.coords();
+  ctx.nelems = mesh.nelems();
+  ctx.geometry = build_element_geometry(mesh);
+  ctx.elems2sides = mesh.ask_down(mesh.dim(), mesh.dim() - 1).ab2b;
+  ctx.sides2elems = buildSides2Elems(mesh);
+  return ctx;
+}
+
+SearchContext& update_search_context(o::Mesh& mesh, SearchContext& ctx) {
+  //The context holds the coordinates it was built from so a new coordinate array can not
+  //  reuse their memory
+  if (ctx.coords.data() != mesh.coords().data() || ctx.nelems != mesh.nelems())
+    ctx = build_search_context(mesh);
+  return ctx;
+}
+
+SearchContext& search_context(o::Mesh& mesh) {
+  static unsigned long uses = 0;
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  ContextCache& cache = context_cache();
+  CachedContext& cached = cache[&mesh];
+  cached.last_use = ++uses;
+  //A mesh destroyed without releasing its context leaves an entry behind
+  while (cache.size() > max_cached_contexts)
+    evict_context(cache, &mesh);
+  return update_search_context(mesh, cached.ctx);
+}
+
+ElementGrid const& search_grid(o::Mesh& mesh, SearchContext& ctx) {
+  ElementGrid& grid = ctx.grid;
+  if (grid.coords.data() != mesh.coords().data() || grid.nelems != mesh.nelems())
+    grid = build_element_grid(mesh);
+  return grid;
+}
+
+void release_search_context(o::Mesh& mesh) {
+  //The cache is cleared when Kokkos is finalized
+  if (Kokkos::is_initialized()) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    context_cache().erase(&mesh);
+  }
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef PUMIPIC_SEARCH_CONTEXT_HPP
+#define PUMIPIC_SEARCH_CONTEXT_HPP
+
+#include "Omega_h_mesh.hpp"
+#include "pumipic_geometry.hpp"
+#include "pumipic_element_grid.hpp"
+
+namespace pumipic {
+
+/* The arrays derived from a mesh that the particle searches read
+
+   The context is computed once per mesh and reused by every search until the
+   coordinates of the mesh change, so building it does not show up in the per step
+   cost of a search. The side adjacencies are stored in fixed size rows:
+     side i of element e is elems2sides[e*nsides + i]
+     the elements on either side of side s are sides2elems[2*s] and sides2elems[2*s+1]
+   Exposed sides have a single element and sides2elems[2*s+1] is -1.
+   The grid is only needed to locate points without a parent element and is built the
+   first time it is asked for.
+ */
+struct SearchContext {
+  //The coordinates the context was computed from
+  Omega_h::Reals coords;
+  Omega_h::LO nelems;
+  ElementGeometry geometry;
+  Omega_h::LOs elems2sides;
+  Omega_h::LOs sides2elems;
+  ElementGrid grid;
+
+  SearchContext() : nelems(0) {}
+};
+
+//Computes the search context of mesh without the grid
+SearchContext build_search_context(Omega_h::Mesh& mesh);
+
+//Rebuilds ctx from mesh if it was computed from other coordinates, returns ctx
+SearchContext& update_search_context(Omega_h::Mesh& mesh, SearchContext& ctx);
+
+/* Returns the search context of mesh held by pumipic
+
+   pumipic::Mesh holds the context of its picpart (pumipic::Mesh::searchContext) and the
+   searches take it as an argument. This cache is the fallback for searches of meshes
+   without a context passed in. The context is built on the first call for a mesh and
+   reused until the coordinates of the mesh change. The least recently used contexts are
+   evicted once the cache holds more than a few meshes, so the contexts of destroyed
+   meshes do not accumulate. Contexts are also released when pumipic::Mesh that owns the
+   mesh is destroyed, when release_search_context is called, or when Kokkos is finalized.
+ */
+SearchContext& search_context(Omega_h::Mesh& mesh);
+
+//Returns ctx brought up to date with mesh, or the cached context of mesh if ctx is NULL
+inline SearchContext& search_context(Omega_h::Mesh& mesh, SearchContext* ctx) {
+  return ctx ? update_search_context(mesh, *ctx) : search_context(mesh);
+}
+
+//Returns the grid of ctx, built from mesh the first time it is asked for
+ElementGrid const& search_grid(Omega_h::Mesh& mesh, SearchContext& ctx);
+
+//Releases the cached search context of mesh
+void release_search_context(Omega_h::Mesh& mesh);
+
+}
+
+#endif
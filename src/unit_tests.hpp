@@ -226,6 +226,66 @@ bool test_barycentric_tri()
   return 1;
 }
 
+//Compares the cached element geometry to the direct barycentric computations at
+//the centroid of each element and at a point outside of it
+bool test_element_geometry(Omega_h::CommPtr world)
+{
+  for(int dim=2; dim<=3; ++dim)
+  {
+    auto mesh = Omega_h::build_box(world, OMEGA_H_SIMPLEX, 1, 1, dim==3, 3, 3,
+                                   dim==3 ? 3 : 0);
+    const auto geom = g::element_geometry(mesh);
+    const auto elm_verts = mesh.ask_elem_verts();
+    const auto coords = mesh.coords();
+    const auto triArea = o::measure_elements_real(&mesh);
+    Omega_h::Write<Omega_h::LO> fails(1, 0);
+    if(dim == 2)
+    {
+      o::parallel_for(mesh.nelems(), OMEGA_H_LAMBDA(const o::LO& e) {
+        const auto faceCoords = o::gather_vectors<3,2>(coords, o::gather_verts<3>(elm_verts, e));
+        const auto centroid = (faceCoords[0] + faceCoords[1] + faceCoords[2]) / 3.0;
+        const o::Vector<2> outside{centroid[0] + 2.0, centroid[1] - 1.0};
+        const o::Few<o::Vector<2>, 2> points{centroid, outside};
+        for(int p=0; p<2; ++p)
+        {
+          o::Vector<3> bcc;
+          g::barycentric_tri(triArea, faceCoords, points[p], bcc, e);
+          const auto cached = geom.barycentric<2>(e, points[p]);
+          for(int i=0; i<3; ++i)
+            if(std::abs(bcc[i] - cached[i]) > 1e-10)
+              Kokkos::atomic_fetch_add(&(fails[0]), 1);
+        }
+      });
+    }
+    else
+    {
+      o::parallel_for(mesh.nelems(), OMEGA_H_LAMBDA(const o::LO& e) {
+        const auto M = o::gather_vectors<4,3>(coords, o::gather_verts<4>(elm_verts, e));
+        const auto centroid = (M[0] + M[1] + M[2] + M[3]) / 4.0;
+        const o::Vector<3> outside{centroid[0] + 2.0, centroid[1] - 1.0, centroid[2]};
+        const o::Few<o::Vector<3>, 2> points{centroid, outside};
+        for(int p=0; p<2; ++p)
+        {
+          o::Vector<4> bcc;
+          g::find_barycentric_tet(M, points[p], bcc);
+          const auto cached = geom.barycentric<3>(e, points[p]);
+          for(int i=0; i<4; ++i)
+            if(std::abs(bcc[i] - cached[i]) > 1e-10)
+              Kokkos::atomic_fetch_add(&(fails[0]), 1);
+        }
+      });
+    }
+    if(Omega_h::HostRead<Omega_h::LO>(fails)[0])
+    {
+#ifdef DEBUG
+      std::cout << "Failed: cached barycentric coordinates differ in " << dim << "D\n";
+#endif // DEBUG
+      return 0;
+    }
+  }
+  return 1;
+}
+
 void test_line_tri_intx()
 {
   Omega_h::Vector<3> xpoint{0, 0, 0};
@@ -50,6 +50,41 @@ namespace pumipic {
       }
     };
     Kokkos::parallel_scan("inclusive_scan", entries.size(), inclusive_sum);
+#endif
+  }
+
+#ifdef PP_USE_CUDA
+  /* Select the thrust execution policy matching a Kokkos execution space instance
+       Cuda instances run on their stream, all other spaces run on the host
+   */
+  inline auto thrustPolicy(const Kokkos::Cuda& exec)
+    -> decltype(thrust::cuda::par.on(exec.cuda_stream())) {
+    return thrust::cuda::par.on(exec.cuda_stream());
+  }
+  template <typename ExecSpace>
+  auto thrustPolicy(const ExecSpace&) -> decltype(thrust::host) {
+    return thrust::host;
+  }
+#endif
+
+  /* Exclusive scan enqueued on the execution space instance `exec`
+     Note: The scan is asynchronous with respect to the host, the caller must fence
+           `exec` before reading the result on the host
+   */
+  template <typename ViewT, typename ExecSpace>
+  void exclusive_scan(ViewT entries, ViewT result, const ExecSpace& exec) {
+#ifdef PP_USE_CUDA
+    thrust::exclusive_scan(thrustPolicy(exec), entries.data(), entries.data() + entries.size(),
+                           result.data(), 0);
+#else
+    auto exclusive_sum = KOKKOS_LAMBDA(const int index, typename ViewT::value_type& cur, const bool final) {
+      if (final) {
+        result(index) = cur;
+      }
+      cur += entries(index);
+    };
+    Kokkos::parallel_scan("exclusive_scan", Kokkos::RangePolicy<ExecSpace>(exec, 0, entries.size()),
+                          exclusive_sum);
 #endif
   }
   /* Taken from https://stackoverflow.com/questions/31762958/check-if-class-is-a-template-specialization
@@ -143,28 +178,42 @@ T getLastValue(Kokkos::View<T*, Device> view) {
   Kokkos::deep_copy(lastVal,Kokkos::subview(view,size-1));
   return lastVal;
 }
+/* Reads the last value of a view after the work on `exec` completes
+   Only the instance `exec` is fenced so work on other instances keeps running
+ */
+template <typename T, typename Device, typename ExecSpace>
+T getLastValue(Kokkos::View<T*, Device> view, const ExecSpace& exec) {
+  const int size = view.size();
+  if (size == 0)
+    return 0;
+  T lastVal;
+  Kokkos::View<T, Kokkos::HostSpace, Kokkos::MemoryTraits<Kokkos::Unmanaged> > last_h(&lastVal);
+  Kokkos::deep_copy(exec, last_h, Kokkos::subview(view,size-1));
+  exec.fence();
+  return lastVal;
+}
 
   template <typename ViewT>
-  PP_INLINE typename std::enable_if<ViewT::rank == 1>::type copyViewToView(ViewT dst, int dstind,
-                                                                           ViewT src, int srcind){
+  PP_INLINE typename std::enable_if<ViewT::rank == 1>::type copyViewToView(ViewT dst, std::size_t dstind,
+                                                                           ViewT src, std::size_t srcind){
     dst(dstind) = src(srcind);
   }
   template <typename ViewT>
-  PP_INLINE typename std::enable_if<ViewT::rank == 2>::type copyViewToView(ViewT dst, int dstind,
-                                                                           ViewT src, int srcind){
+  PP_INLINE typename std::enable_if<ViewT::rank == 2>::type copyViewToView(ViewT dst, std::size_t dstind,
+                                                                           ViewT src, std::size_t srcind){
     for (int i = 0; i < dst.extent(1); ++i)
       dst(dstind, i) = src(srcind, i);
   }
   template <typename ViewT>
-  PP_INLINE typename std::enable_if<ViewT::rank == 3>::type copyViewToView(ViewT dst, int dstind,
-                                                                           ViewT src, int srcind){
+  PP_INLINE typename std::enable_if<ViewT::rank == 3>::type copyViewToView(ViewT dst, std::size_t dstind,
+                                                                           ViewT src, std::size_t srcind){
     for (int i = 0; i < dst.extent(1); ++i)
       for (int j = 0; j < dst.extent(2); ++j)
         dst(dstind, i, j) = src(srcind, i, j);
   }
   template <typename ViewT>
-  PP_INLINE typename std::enable_if<ViewT::rank == 4>::type copyViewToView(ViewT dst, int dstind,
-                                                                           ViewT src, int srcind){
+  PP_INLINE typename std::enable_if<ViewT::rank == 4>::type copyViewToView(ViewT dst, std::size_t dstind,
+                                                                           ViewT src, std::size_t srcind){
     for (int i = 0; i < dst.extent(1); ++i)
       for (int j = 0; j < dst.extent(2); ++j)
         for (int k = 0; k < dst.extent(3); ++k)
@@ -173,7 +222,7 @@ T getLastValue(Kokkos::View<T*, Device> view) {
 
   template <typename T> struct Subview {
     template <typename View>
-    static View subview(View view, int start, int size) {
+    static View subview(View view, std::size_t start, std::size_t size) {
       View new_view("subview", size);
       Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
         new_view(i) = view(start + i);
@@ -183,7 +232,7 @@ T getLastValue(Kokkos::View<T*, Device> view) {
   };
   template <typename T, size_t N> struct Subview<T[N]> {
     template <typename View>
-    static View subview(View view, int start, int size) {
+    static View subview(View view, std::size_t start, std::size_t size) {
       View new_view("subview", size);
       Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
         for (int j = 0; j < N; ++j)
@@ -195,7 +244,7 @@ T getLastValue(Kokkos::View<T*, Device> view) {
   template <typename T, size_t N, size_t M>
   struct Subview<T[N][M]> {
     template <typename View>
-    static View subview(View view, int start, int size) {
+    static View subview(View view, std::size_t start, std::size_t size) {
       View new_view("subview", size);
       Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
         for (int j = 0; j < N; ++j)
@@ -208,7 +257,7 @@ T getLastValue(Kokkos::View<T*, Device> view) {
   template <typename T, size_t N, size_t M, size_t P>
   struct Subview<T[N][M][P]> {
     template <typename View>
-    static View subview(View view, int start, int size) {
+    static View subview(View view, std::size_t start, std::size_t size) {
       View new_view("subview", size);
       Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
         for (int j = 0; j < N; ++j)
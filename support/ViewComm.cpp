@@ -1,13 +1,150 @@
 #include "ViewComm.h"
+#include "ppAssert.h"
 #include <unordered_map>
 #include <mpi.h>
 #include <functional>
+#include <cstdlib>
+#include <cstring>
 namespace pumipic {
 
   Irecv_Map lambda_map;
 
   Irecv_Map& get_map() {return lambda_map;}
 
+  void PS_Comm_Complete(MPI_Request* request) {
+    Irecv_Map::iterator itr = get_map().find(request);
+    if (itr != get_map().end()) {
+      (itr->second)();
+      get_map().erase(itr);
+    }
+  }
+
+  namespace {
+    PS_Comm_Transport defaultTransport() {
+      const char* env = std::getenv("PS_COMM_TRANSPORT");
+      if (env && std::strcmp(env, "staged") == 0)
+        return PS_COMM_STAGED;
+      if (env && std::strcmp(env, "direct") == 0)
+        return PS_COMM_DIRECT;
+#ifdef PS_CUDA_AWARE_MPI
+      return PS_COMM_DIRECT;
+#else
+      return PS_COMM_STAGED;
+#endif
+    }
+    PS_Comm_Transport transport = defaultTransport();
+    //4MB chunks keep a few chunks in flight for typical migration messages
+    std::size_t chunk_bytes = 1 << 22;
+  }
+
+  void PS_Comm_Set_Transport(PS_Comm_Transport t) {transport = t;}
+  PS_Comm_Transport PS_Comm_Get_Transport() {return transport;}
+  void PS_Comm_Set_Chunk_Bytes(std::size_t bytes) {
+    //Each chunk is one MPI message so its size must fit in an int
+    chunk_bytes = std::min<std::size_t>(std::max<std::size_t>(bytes, 1), INT_MAX);
+  }
+  std::size_t PS_Comm_Get_Chunk_Bytes() {return chunk_bytes;}
+
+  StagingPool::Buffer StagingPool::acquire(std::size_t bytes) {
+    int best = -1;
+    for (std::size_t i = 0; i < free_buffers.size(); ++i) {
+      const std::size_t size = free_buffers[i].size();
+      if (size >= bytes && (best == -1 || size < free_buffers[best].size()))
+        best = i;
+    }
+    if (best == -1) {
+      ++allocations;
+      return Buffer(Kokkos::ViewAllocateWithoutInitializing("ps_comm_staging"),
+                    std::max<std::size_t>(bytes, 1));
+    }
+    ++reuses;
+    Buffer buffer = free_buffers[best];
+    free_buffers[best] = free_buffers.back();
+    free_buffers.pop_back();
+    return buffer;
+  }
+
+  void StagingPool::release(Buffer buffer) {
+    free_buffers.push_back(buffer);
+  }
+
+  void StagingPool::clear() {
+    free_buffers.clear();
+  }
+
+  StagingPool& get_staging_pool() {
+    static StagingPool pool;
+    //The buffers must be deallocated before Kokkos is, the hook is registered once by the
+    //  thread-safe initialization of the static
+    static const bool hooked = []() {
+      Kokkos::push_finalize_hook([]() {get_staging_pool().clear();});
+      return true;
+    }();
+    (void)hooked;
+    return pool;
+  }
+
+  RequestGroup::RequestGroup(int capacity) : requests(capacity, MPI_REQUEST_NULL),
+                                             callbacks(capacity), indices(capacity),
+                                             num_added(0), num_active(0) {}
+
+  RequestGroup::~RequestGroup() {
+    waitAll();
+  }
+
+  MPI_Request* RequestGroup::add(Callback on_complete) {
+    PS_ALWAYS_ASSERT(num_added < capacity());
+    const int index = num_added++;
+    ++num_active;
+    requests[index] = MPI_REQUEST_NULL;
+    callbacks[index] = on_complete;
+    return requests.data() + index;
+  }
+
+  void RequestGroup::complete(int index) {
+    PS_Comm_Complete(requests.data() + index);
+    --num_active;
+    if (callbacks[index])
+      callbacks[index](index);
+  }
+
+  int RequestGroup::testSome() {
+    if (num_active == 0)
+      return 0;
+    int num_completed;
+    MPI_Testsome(num_added, requests.data(), &num_completed, indices.data(),
+                 MPI_STATUSES_IGNORE);
+    //Requests that were never started are inactive
+    if (num_completed == MPI_UNDEFINED) {
+      num_active = 0;
+      return 0;
+    }
+    for (int i = 0; i < num_completed; ++i)
+      complete(indices[i]);
+    return num_completed;
+  }
+
+  int RequestGroup::waitAny() {
+    if (num_active == 0)
+      return MPI_UNDEFINED;
+    int index;
+    MPI_Waitany(num_added, requests.data(), &index, MPI_STATUS_IGNORE);
+    if (index != MPI_UNDEFINED)
+      complete(index);
+    else
+      num_active = 0;
+    return index;
+  }
+
+  void RequestGroup::waitAll() {
+    while (waitAny() != MPI_UNDEFINED);
+  }
+
+  void RequestGroup::reset() {
+    PS_ALWAYS_ASSERT(num_active == 0);
+    num_added = 0;
+  }
+
   //Adapted from https://www.open-mpi.org/faq/?category=runcuda
   bool checkCudaAwareMPI() {
     printf("Compile time check:\n");
@@ -3,13 +3,17 @@
 #include <Kokkos_Core.hpp>
 #include "SupportKK.h"
 #include <unordered_map>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <climits>
 #include <mpi.h>
+#include "ppAssert.h"
 namespace pumipic {
   /* Routines to be abstracted
      MPI_Allgather/NCCL
      MPI_Broadcast/NCCL
-     MPI_Alltoallv
-     MPI_Waitany
   */
 
 #if false //These function headers are for documentation purposes only
@@ -46,9 +50,12 @@ namespace pumipic {
     \note The function call is equivalent to
     MPI_Send(view.data() + offset, size, datatype, dest, tag, comm);
 
+    \note The offset may exceed the range of an int but the number of values sent must not
+
   */
   template <typename ViewT>
-  int PS_Comm_Send(ViewT view, int offset, int size, int dest, int tag, MPI_Comm comm);
+  int PS_Comm_Send(ViewT view, std::size_t offset, std::size_t size, int dest, int tag,
+                   MPI_Comm comm);
   /*!
     \brief Wrapper around MPI_Recv for views
 
@@ -71,10 +78,14 @@ namespace pumipic {
     \note The function call is equivalent to
     MPI_Recv(view.data() + offset, size, datatype, source, tag, comm);
 
+    \note The offset may exceed the range of an int but the number of values received must
+    not
+
   */
 
   template <typename ViewT>
-  int PS_Comm_Recv(ViewT view, int offset, int size, int source, int tag, MPI_Comm comm);
+  int PS_Comm_Recv(ViewT view, std::size_t offset, std::size_t size, int source, int tag,
+                   MPI_Comm comm);
 
   /*!
     \brief Wrapper around MPI_Isend for views
@@ -99,10 +110,12 @@ namespace pumipic {
 
     \note The function call is equivalent to
     MPI_Isend(view.data() + offset, size, datatype, dest, tag, comm, request);
+
+    \note The offset may exceed the range of an int but the number of values sent must not
   */
 
   template <typename ViewT>
-  int PS_Comm_Isend(ViewT view, int offset, int size, int dest, int tag,
+  int PS_Comm_Isend(ViewT view, std::size_t offset, std::size_t size, int dest, int tag,
                     MPI_Comm comm, MPI_Request* request);
 
   /*!
@@ -129,10 +142,13 @@ namespace pumipic {
     \note The function call is equivalent to
     MPI_Irecv(view.data() + offset, size, datatype, source, tag, comm, request);
 
+    \note The offset may exceed the range of an int but the number of values received must
+    not
+
   */
 
   template <typename ViewT>
-  int PS_Comm_Irecv(ViewT view, int offset, int size, int dest, int tag,
+  int PS_Comm_Irecv(ViewT view, std::size_t offset, std::size_t size, int dest, int tag,
                     MPI_Comm comm, MPI_Request* request);
 
   /*!
@@ -152,6 +168,9 @@ namespace pumipic {
     \note PS_Comm_Wait must be used instead of MPI_Wait if using the
     PS_Comm_Isend/Irecv functions on the device in order to finish copying the data.
 
+    \note The received data is in the view when the wait returns, so it may be read on
+    any execution space instance without another fence.
+
   */
   template <typename Space>
   int PS_Comm_Wait(MPI_Request* request, MPI_Status* status);
@@ -179,6 +198,33 @@ namespace pumipic {
   template <typename Space>
   int PS_Comm_Waitall(int num_requests, MPI_Request* requests, MPI_Status* statuses);
 
+  /*!
+    \brief Wrapper around MPI_Waitany
+
+    \tparam Space The memory space where the sends/recvs occurred
+
+    \param num_requests The number of requests
+
+    \param requests The array of requests sized `num_requests`
+
+    \param[out] index The index of the completed request or MPI_UNDEFINED if all
+    requests are inactive
+
+    \param[out] status The status filled by the MPI_Waitany
+
+    \return The error value returned by the call to MPI
+
+    \note The function call is equivalent to
+    MPI_Waitany(num_requests, requests, index, status);
+
+    \note PS_Comm_Waitany must be used instead of MPI_Waitany if using the
+    PS_Comm_Isend/Irecv functions on the device in order to finish copying the data of
+    the completed request.
+
+  */
+  template <typename Space>
+  int PS_Comm_Waitany(int num_requests, MPI_Request* requests, int* index, MPI_Status* status);
+
   /*!
     \brief Wrapper around MPI_Alltoall for views
 
@@ -236,6 +282,37 @@ namespace pumipic {
   int PS_Comm_Ialltoall(ViewT send_view, int send_size, ViewT recv_view, int recv_size,
                         MPI_Comm comm, MPI_Request* request);
 
+  /*!
+    \brief Wrapper around MPI_Ineighbor_alltoall for views
+
+    \tparam ViewT The type of view, supports Kokkos::View & pumipic::View
+
+    \param send_view The view with data on either the host or device to send
+
+    \param send_size The number of elements to send to each neighbor
+
+    \param recv_view The view with data on either the host or device to receive
+
+    \param recv_size The number of elements to recv from each neighbor
+
+    \param comm The MPI communicator with a (distributed) graph topology
+
+    \param[out] request The MPI request to be filled after the MPI_Ineighbor_alltoall completes
+
+    \return The error value returned by the call to MPI
+
+    \note The function call is equivalent to
+    MPI_Ineighbor_alltoall(send_view.data(), send_size, send_datatype,
+    recv_view.data(), recv_size, recv_datatype, comm, request);
+
+    \note Entries are ordered by the destinations/sources used to create the graph
+
+    \note The send_view and recv_view must be allocated on the same memory space
+  */
+  template <typename ViewT>
+  int PS_Comm_Ineighbor_alltoall(ViewT send_view, int send_size, ViewT recv_view, int recv_size,
+                                 MPI_Comm comm, MPI_Request* request);
+
   /*!
     \brief Wrapper around MPI_Reduce for views
 
@@ -289,6 +366,84 @@ namespace pumipic {
   template <typename ViewT>
   int PS_Comm_Allreduce(ViewT send_view, ViewT recv_view, int count, MPI_Op op, MPI_Comm comm);
 
+  /*!
+    \brief Wrapper around MPI_Iallreduce for views
+
+    \tparam ViewT The type of view, supports Kokkos::View & pumipic::View
+
+    \param send_view The view with data on either the host or device
+
+    \param[out] recv_view The view in the same memory space as `send_view` to be filled
+    with the reduction once the request completes
+
+    \param count The number of elements in `send_view`
+
+    \param op The MPI operation to be carried out in the reduction
+
+    \param comm The MPI communicator
+
+    \param[out] request The MPI request to be filled after the MPI_Iallreduce completes
+
+    \return The error value returned by the call to MPI
+
+    \note The function call is equivalent to
+    MPI_Iallreduce(send_view.data(), recv_view.data(), count, op, comm, request);
+
+    \note The request must be completed with a PS_Comm wait or a RequestGroup
+  */
+  template <typename ViewT>
+  int PS_Comm_Iallreduce(ViewT send_view, ViewT recv_view, int count, MPI_Op op,
+                         MPI_Comm comm, MPI_Request* request);
+
+  /*!
+    \brief Wrapper around MPI_Alltoallv for views
+
+    \tparam ViewT The type of view, supports Kokkos::View & pumipic::View
+
+    \param send_view The view with data on either the host or device to send
+
+    \param send_counts The number of entries of the view to send to each process (host array)
+
+    \param send_displs The index of the first entry sent to each process (host array)
+
+    \param recv_view The view with data on either the host or device to receive
+
+    \param recv_counts The number of entries to recv from each process (host array)
+
+    \param recv_displs The index where the entries from each process are received
+    (host array)
+
+    \param comm The MPI communicator
+
+    \return The error value returned by the call to MPI
+
+    \note The function call is equivalent to
+    MPI_Alltoallv(send_view.data(), send_counts, send_displs, send_datatype,
+                  recv_view.data(), recv_counts, recv_displs, recv_datatype, comm);
+    with the counts and displacements scaled by the number of values per entry
+
+    \note The send_view and recv_view must be allocated on the same memory space
+  */
+  template <typename ViewT>
+  int PS_Comm_Alltoallv(ViewT send_view, const int* send_counts, const int* send_displs,
+                        ViewT recv_view, const int* recv_counts, const int* recv_displs,
+                        MPI_Comm comm);
+
+  /*!
+    \brief Wrapper around MPI_Ialltoallv for views
+
+    The arguments match PS_Comm_Alltoallv. The count and displacement arrays are copied
+    so they may be modified before the request completes.
+
+    \param[out] request The MPI request to be filled after the MPI_Ialltoallv completes
+
+    \note The request must be completed with a PS_Comm wait or a RequestGroup
+  */
+  template <typename ViewT>
+  int PS_Comm_Ialltoallv(ViewT send_view, const int* send_counts, const int* send_displs,
+                         ViewT recv_view, const int* recv_counts, const int* recv_displs,
+                         MPI_Comm comm, MPI_Request* request);
+
 #endif
 
   template <typename T> struct MpiType;
@@ -317,6 +472,28 @@ namespace pumipic {
   using Irecv_Map=std::unordered_map<MPI_Request*, std::function<void()> >;
   Irecv_Map& get_map();
 
+  //Number of values of the base type in size entries of a view, MPI counts are ints
+  template <typename ViewT>
+  int PS_Comm_Count(std::size_t size) {
+    const std::size_t count = size * BaseType<ViewType<ViewT> >::size;
+    PS_ALWAYS_ASSERT(count <= static_cast<std::size_t>(INT_MAX));
+    return count;
+  }
+
+  //Count or displacement array of a v collective in values of the base type
+  typedef std::shared_ptr<std::vector<int> > Comm_Counts;
+  inline Comm_Counts PS_Comm_Scale_Counts(const int* counts, int scale, MPI_Comm comm) {
+    int comm_size;
+    MPI_Comm_size(comm, &comm_size);
+    Comm_Counts scaled(new std::vector<int>(counts, counts + comm_size));
+    for (int i = 0; i < comm_size; ++i)
+      (*scaled)[i] *= scale;
+    return scaled;
+  }
+
+#include "ViewComm_staging.hpp"
+
+#include "ViewComm_requests.hpp"
 
 #include "ViewComm_host.hpp"
 
@@ -17,31 +17,31 @@ bool checkCudaAwareMPI();
 
 //Send
   template <typename ViewT>
-  IsCuda<ViewSpace<ViewT> > PS_Comm_Send(ViewT view, int offset, int size,
+  IsCuda<ViewSpace<ViewT> > PS_Comm_Send(ViewT view, std::size_t offset, std::size_t size,
                                          int dest, int tag, MPI_Comm comm) {
     auto subview = Subview<ViewType<ViewT> >::subview(view, offset, size);
 
 #ifdef PS_CUDA_AWARE_MPI
-    return MPI_Send(subview.data(), subview.size(), MpiType<BT<ViewType<ViewT> > >::mpitype(),
-                    dest, tag, comm);
+    return MPI_Send(subview.data(), PS_Comm_Count<ViewT>(size),
+                    MpiType<BT<ViewType<ViewT> > >::mpitype(), dest, tag, comm);
 #else
     auto view_host = deviceToHost(subview);
-    return MPI_Send(view_host.data(), view_host.size(), MpiType<BT<ViewType<ViewT> > >::mpitype(),
-                    dest, tag, comm);
+    return MPI_Send(view_host.data(), PS_Comm_Count<ViewT>(size),
+                    MpiType<BT<ViewType<ViewT> > >::mpitype(), dest, tag, comm);
 #endif
   }
   //Recv
   template <typename ViewT>
-  IsCuda<ViewSpace<ViewT> > PS_Comm_Recv(ViewT view, int offset, int size,
+  IsCuda<ViewSpace<ViewT> > PS_Comm_Recv(ViewT view, std::size_t offset, std::size_t size,
                                          int sender, int tag, MPI_Comm comm) {
     ViewT new_view("recv_view", size);
 #ifdef PS_CUDA_AWARE_MPI
-    int ret = MPI_Recv(new_view.data(), new_view.size(),
+    int ret = MPI_Recv(new_view.data(), PS_Comm_Count<ViewT>(size),
                        MpiType<BT<ViewType<ViewT> > >::mpitype(),
                        sender, tag, comm, MPI_STATUS_IGNORE);
 #else
     typename ViewT::HostMirror view_host = create_mirror_view(new_view);
-    int ret = MPI_Recv(view_host.data(), view_host.size(),
+    int ret = MPI_Recv(view_host.data(), PS_Comm_Count<ViewT>(size),
                        MpiType<BT<ViewType<ViewT> > >::mpitype(),
                        sender, tag, comm, MPI_STATUS_IGNORE);
     //Copy received values to device and move it to the proper indices of the view
@@ -50,92 +50,85 @@ bool checkCudaAwareMPI();
     Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
         copyViewToView(view,i+offset, new_view, i);
     });
+    Kokkos::DefaultExecutionSpace().fence();
     return ret;
   }
 
   //Isend
   template <typename ViewT>
-  IsCuda<ViewSpace<ViewT> > PS_Comm_Isend(ViewT view, int offset, int size,
+  IsCuda<ViewSpace<ViewT> > PS_Comm_Isend(ViewT view, std::size_t offset, std::size_t size,
                                   int dest, int tag, MPI_Comm comm, MPI_Request* req) {
-    auto subview = Subview<ViewType<ViewT> >::subview(view, offset, size);
 #ifdef PS_CUDA_AWARE_MPI
-    return MPI_Isend(subview.data(), subview.size(),
-                     MpiType<BT<ViewType<ViewT> > >::mpitype(), dest,
-                     tag, comm, req);
-#else
-    auto view_host = deviceToHost(subview);
-    int ret =  MPI_Isend(view_host.data(), view_host.size(),
-                         MpiType<BT<ViewType<ViewT> > >::mpitype(), dest,
-                         tag, comm, req);
-    //Noop that will keep the view_host around until the lambda is removed
-    get_map()[req] = [=]() {
-      (void)view_host;
-    };
-    return ret;
+    //Views of single values are sent in place
+    if (PS_Comm_Get_Transport() == PS_COMM_DIRECT && BaseType<ViewType<ViewT> >::size == 1)
+      return MPI_Isend(view.data() + offset, PS_Comm_Count<ViewT>(size),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(), dest, tag, comm, req);
+    if (PS_Comm_Get_Transport() == PS_COMM_DIRECT) {
+      auto subview = Subview<ViewType<ViewT> >::subview(view, offset, size);
+      int ret = MPI_Isend(subview.data(), PS_Comm_Count<ViewT>(size),
+                          MpiType<BT<ViewType<ViewT> > >::mpitype(), dest,
+                          tag, comm, req);
+      //Noop that will keep the subview around until the lambda is removed
+      get_map()[req] = [=]() {
+        (void)subview;
+      };
+      return ret;
+    }
 #endif
+    return PS_Comm_Isend_Staged(view, offset, size, dest, tag, comm, req);
   }
   //Irecv
   template <typename ViewT>
-  IsCuda<ViewSpace<ViewT> > PS_Comm_Irecv(ViewT view, int offset, int size,
+  IsCuda<ViewSpace<ViewT> > PS_Comm_Irecv(ViewT view, std::size_t offset, std::size_t size,
                                   int sender, int tag, MPI_Comm comm, MPI_Request* req) {
-    ViewT new_view("irecv_view", size);
 #ifdef PS_CUDA_AWARE_MPI
-    int ret = MPI_Irecv(new_view.data(), new_view.size(),
-                        MpiType<BT<ViewType<ViewT> > >::mpitype(), sender,
-                        tag, comm, req);
-#else
-    int size_per_entry = BaseType<ViewType<ViewT> >::size;
-    typename ViewT::HostMirror view_host = create_mirror_view(new_view);
-    int ret = MPI_Irecv(view_host.data(), size * size_per_entry,
-                        MpiType<BT<ViewType<ViewT> > >::mpitype(),
-                        sender, tag, comm, req);
-#endif
-    get_map()[req] = [=]() {
-#ifndef PS_CUDA_AWARE_MPI
-      deep_copy(new_view, view_host);
-#endif
-      Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
+    //Views of single values are received in place without a temporary view or copy
+    if (PS_Comm_Get_Transport() == PS_COMM_DIRECT && BaseType<ViewType<ViewT> >::size == 1)
+      return MPI_Irecv(view.data() + offset, PS_Comm_Count<ViewT>(size),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(), sender, tag, comm, req);
+    if (PS_Comm_Get_Transport() == PS_COMM_DIRECT) {
+      ViewT new_view("irecv_view", size);
+      int ret = MPI_Irecv(new_view.data(), PS_Comm_Count<ViewT>(size),
+                          MpiType<BT<ViewType<ViewT> > >::mpitype(), sender,
+                          tag, comm, req);
+      //The values must be in the view when the wait returns since the caller may read
+      // them on any execution space instance
+      get_map()[req] = [=]() {
+        Kokkos::parallel_for(size, KOKKOS_LAMBDA(const int& i) {
           copyViewToView(view,i+offset, new_view, i);
-      });
-    };
-
-    return ret;
-
+        });
+        Kokkos::DefaultExecutionSpace().fence();
+      };
+      return ret;
+    }
+#endif
+    return PS_Comm_Irecv_Staged(view, offset, size, sender, tag, comm, req);
   }
 
   //Wait
   template <typename Space>
   IsCuda<Space> PS_Comm_Wait(MPI_Request* req, MPI_Status* stat) {
-#ifdef PS_CUDA_AWARE_MPI
-    return MPI_Wait(req, stat);
-#else
     int ret = MPI_Wait(req, stat);
-    Irecv_Map::iterator itr = get_map().find(req);
-    if (itr != get_map().end()) {
-      (itr->second)();
-      get_map().erase(itr);
-    }
+    PS_Comm_Complete(req);
     return ret;
-#endif
   }
 
   //Waitall
   template <typename Space>
   IsCuda<Space> PS_Comm_Waitall(int num_reqs, MPI_Request* reqs, MPI_Status* stats) {
-#ifdef PS_CUDA_AWARE_MPI
-    return MPI_Waitall(num_reqs, reqs, stats);
-#else
     int ret = MPI_Waitall(num_reqs, reqs, stats);
-    for (int i = 0; i < num_reqs; ++i) {
-      Irecv_Map::iterator itr = get_map().find(reqs + i);
-      if (itr != get_map().end()) {
-        (itr->second)();
-        get_map().erase(itr);
-      }
-    }
+    for (int i = 0; i < num_reqs; ++i)
+      PS_Comm_Complete(reqs + i);
     return ret;
-#endif
+  }
 
+  //Waitany
+  template <typename Space>
+  IsCuda<Space> PS_Comm_Waitany(int num_reqs, MPI_Request* reqs, int* index, MPI_Status* stat) {
+    int ret = MPI_Waitany(num_reqs, reqs, index, stat);
+    if (*index != MPI_UNDEFINED)
+      PS_Comm_Complete(reqs + *index);
+    return ret;
   }
 
   //Alltoall
@@ -179,6 +172,30 @@ IsCuda<ViewSpace<ViewT> > PS_Comm_Ialltoall(ViewT send, int send_size,
 #endif
   }
 
+//Ineighbor_alltoall
+template <typename ViewT>
+IsCuda<ViewSpace<ViewT> > PS_Comm_Ineighbor_alltoall(ViewT send, int send_size,
+                                                     ViewT recv, int recv_size,
+                                                     MPI_Comm comm, MPI_Request* request) {
+#ifdef PS_CUDA_AWARE_MPI
+  return MPI_Ineighbor_alltoall(send.data(), send_size, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                                recv.data(), recv_size, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                                comm, request);
+#else
+  typename ViewT::HostMirror send_host = deviceToHost(send);
+  typename ViewT::HostMirror recv_host = create_mirror_view(recv);
+  int ret = MPI_Ineighbor_alltoall(send_host.data(), send_size,
+                                   MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                                   recv_host.data(), recv_size,
+                                   MpiType<BT<ViewType<ViewT> > >::mpitype(), comm, request);
+  //The host send buffer must outlive the request
+  get_map()[request] = [send_host, recv, recv_host]() {
+    deep_copy(recv, recv_host);
+  };
+  return ret;
+#endif
+}
+
 //reduce
 template <typename ViewT>
 IsCuda<ViewSpace<ViewT> > PS_Comm_Reduce(ViewT send_view, ViewT recv_view, int count,
@@ -220,4 +237,85 @@ IsCuda<ViewSpace<ViewT> > PS_Comm_Allreduce(ViewT send_view, ViewT recv_view, in
 }
 
 
+//iallreduce
+template <typename ViewT>
+IsCuda<ViewSpace<ViewT> > PS_Comm_Iallreduce(ViewT send_view, ViewT recv_view, int count,
+                                             MPI_Op op, MPI_Comm comm, MPI_Request* request) {
+#ifdef PS_CUDA_AWARE_MPI
+  return MPI_Iallreduce(send_view.data(), recv_view.data(), count,
+                        MpiType<BT<ViewType<ViewT> > >::mpitype(), op, comm, request);
+#else
+  typename ViewT::HostMirror send_host = deviceToHost(send_view);
+  typename ViewT::HostMirror recv_host = create_mirror_view(recv_view);
+  int ret = MPI_Iallreduce(send_host.data(), recv_host.data(), count,
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(), op, comm, request);
+  get_map()[request] = [send_host, recv_view, recv_host]() {
+    deep_copy(recv_view, recv_host);
+  };
+  return ret;
+#endif
+}
+
+//Alltoallv
+template <typename ViewT>
+IsCuda<ViewSpace<ViewT> > PS_Comm_Alltoallv(ViewT send, const int* send_counts,
+                                            const int* send_displs,
+                                            ViewT recv, const int* recv_counts,
+                                            const int* recv_displs, MPI_Comm comm) {
+  int size_per_entry = BaseType<ViewType<ViewT> >::size;
+  Comm_Counts sc = PS_Comm_Scale_Counts(send_counts, size_per_entry, comm);
+  Comm_Counts sd = PS_Comm_Scale_Counts(send_displs, size_per_entry, comm);
+  Comm_Counts rc = PS_Comm_Scale_Counts(recv_counts, size_per_entry, comm);
+  Comm_Counts rd = PS_Comm_Scale_Counts(recv_displs, size_per_entry, comm);
+#ifdef PS_CUDA_AWARE_MPI
+  return MPI_Alltoallv(send.data(), sc->data(), sd->data(),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                       recv.data(), rc->data(), rd->data(),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(), comm);
+#else
+  typename ViewT::HostMirror send_host = deviceToHost(send);
+  typename ViewT::HostMirror recv_host = create_mirror_view(recv);
+  int ret = MPI_Alltoallv(send_host.data(), sc->data(), sd->data(),
+                          MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                          recv_host.data(), rc->data(), rd->data(),
+                          MpiType<BT<ViewType<ViewT> > >::mpitype(), comm);
+  deep_copy(recv, recv_host);
+  return ret;
+#endif
+}
+
+//Ialltoallv
+template <typename ViewT>
+IsCuda<ViewSpace<ViewT> > PS_Comm_Ialltoallv(ViewT send, const int* send_counts,
+                                             const int* send_displs,
+                                             ViewT recv, const int* recv_counts,
+                                             const int* recv_displs, MPI_Comm comm,
+                                             MPI_Request* request) {
+  int size_per_entry = BaseType<ViewType<ViewT> >::size;
+  Comm_Counts sc = PS_Comm_Scale_Counts(send_counts, size_per_entry, comm);
+  Comm_Counts sd = PS_Comm_Scale_Counts(send_displs, size_per_entry, comm);
+  Comm_Counts rc = PS_Comm_Scale_Counts(recv_counts, size_per_entry, comm);
+  Comm_Counts rd = PS_Comm_Scale_Counts(recv_displs, size_per_entry, comm);
+#ifdef PS_CUDA_AWARE_MPI
+  int ret = MPI_Ialltoallv(send.data(), sc->data(), sd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                           recv.data(), rc->data(), rd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(), comm, request);
+  get_map()[request] = [sc, sd, rc, rd]() {};
+#else
+  typename ViewT::HostMirror send_host = deviceToHost(send);
+  typename ViewT::HostMirror recv_host = create_mirror_view(recv);
+  int ret = MPI_Ialltoallv(send_host.data(), sc->data(), sd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                           recv_host.data(), rc->data(), rd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(), comm, request);
+  //The host buffers and count arrays must outlive the request
+  get_map()[request] = [sc, sd, rc, rd, send_host, recv, recv_host]() {
+    deep_copy(recv, recv_host);
+  };
+#endif
+  return ret;
+}
+
+
 #endif
@@ -4,34 +4,34 @@ template <typename Space> using IsHost =
                                                      Kokkos::HostSpace>::accessible, int>::type;
 //Send
 template <typename ViewT>
-IsHost<ViewSpace<ViewT> > PS_Comm_Send(ViewT view, int offset, int size,
+IsHost<ViewSpace<ViewT> > PS_Comm_Send(ViewT view, std::size_t offset, std::size_t size,
                                        int dest, int tag, MPI_Comm comm) {
-  int size_per_entry = BaseType<ViewType<ViewT> >::size;
-  return MPI_Send(view.data() + offset, size*size_per_entry,
+  const int count = PS_Comm_Count<ViewT>(size);
+  return MPI_Send(view.data() + offset, count,
                   MpiType<BT<ViewType<ViewT> > >::mpitype(), dest, tag, comm);
 }
 //Recv
 template <typename ViewT>
-IsHost<ViewSpace<ViewT> > PS_Comm_Recv(ViewT view, int offset, int size,
+IsHost<ViewSpace<ViewT> > PS_Comm_Recv(ViewT view, std::size_t offset, std::size_t size,
                                        int sender, int tag, MPI_Comm comm) {
-  int size_per_entry = BaseType<ViewType<ViewT> >::size;
-  return MPI_Recv(view.data() + offset, size*size_per_entry, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+  const int count = PS_Comm_Count<ViewT>(size);
+  return MPI_Recv(view.data() + offset, count, MpiType<BT<ViewType<ViewT> > >::mpitype(),
                   sender, tag, comm, MPI_STATUS_IGNORE);
 }
 //Isend
 template <typename ViewT>
-IsHost<ViewSpace<ViewT> > PS_Comm_Isend(ViewT view, int offset, int size,
+IsHost<ViewSpace<ViewT> > PS_Comm_Isend(ViewT view, std::size_t offset, std::size_t size,
                                         int dest, int tag, MPI_Comm comm, MPI_Request* req) {
-  int size_per_entry = BaseType<ViewType<ViewT> >::size;
-  return MPI_Isend(view.data() + offset, size*size_per_entry, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+  const int count = PS_Comm_Count<ViewT>(size);
+  return MPI_Isend(view.data() + offset, count, MpiType<BT<ViewType<ViewT> > >::mpitype(),
                    dest, tag, comm, req);
 }
 //Irecv
 template <typename ViewT>
-IsHost<ViewSpace<ViewT> > PS_Comm_Irecv(ViewT view, int offset, int size,
+IsHost<ViewSpace<ViewT> > PS_Comm_Irecv(ViewT view, std::size_t offset, std::size_t size,
                                         int sender, int tag, MPI_Comm comm, MPI_Request* req) {
-  int size_per_entry = BaseType<ViewType<ViewT> >::size;
-  return MPI_Irecv(view.data() + offset, size*size_per_entry,
+  const int count = PS_Comm_Count<ViewT>(size);
+  return MPI_Irecv(view.data() + offset, count,
                    MpiType<BT<ViewType<ViewT> > >::mpitype(),
                    sender, tag, comm, req);
 }
@@ -39,13 +39,29 @@ IsHost<ViewSpace<ViewT> > PS_Comm_Irecv(ViewT view, int offset, int size,
 //Wait
 template <typename Space>
 IsHost<Space> PS_Comm_Wait(MPI_Request* req, MPI_Status* stat) {
-  return MPI_Wait(req, stat);
+  int ret = MPI_Wait(req, stat);
+  //Finish staged messages (see ViewComm_staging.hpp)
+  if (!get_map().empty())
+    PS_Comm_Complete(req);
+  return ret;
 }
 
 //Waitall
 template <typename Space>
 IsHost<Space> PS_Comm_Waitall(int num_reqs, MPI_Request* reqs, MPI_Status* stats) {
-  return MPI_Waitall(num_reqs, reqs, stats);
+  int ret = MPI_Waitall(num_reqs, reqs, stats);
+  for (int i = 0; i < num_reqs && !get_map().empty(); ++i)
+    PS_Comm_Complete(reqs + i);
+  return ret;
+}
+
+//Waitany
+template <typename Space>
+IsHost<Space> PS_Comm_Waitany(int num_reqs, MPI_Request* reqs, int* index, MPI_Status* stat) {
+  int ret = MPI_Waitany(num_reqs, reqs, index, stat);
+  if (*index != MPI_UNDEFINED && !get_map().empty())
+    PS_Comm_Complete(reqs + *index);
+  return ret;
 }
 //Alltoall
 template <typename ViewT>
@@ -66,6 +82,16 @@ IsHost<ViewSpace<ViewT> > PS_Comm_Ialltoall(ViewT send, int send_size,
 
 }
 
+//Ineighbor_alltoall
+template <typename ViewT>
+IsHost<ViewSpace<ViewT> > PS_Comm_Ineighbor_alltoall(ViewT send, int send_size,
+                                                     ViewT recv, int recv_size,
+                                                     MPI_Comm comm, MPI_Request* request) {
+  return MPI_Ineighbor_alltoall(send.data(), send_size, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                                recv.data(), recv_size, MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                                comm, request);
+}
+
 //reduce
 template <typename ViewT>
 IsHost<ViewSpace<ViewT> > PS_Comm_Reduce(ViewT send_view, ViewT recv_view, int count,
@@ -83,3 +109,49 @@ IsHost<ViewSpace<ViewT> > PS_Comm_Allreduce(ViewT send_view, ViewT recv_view, in
   return MPI_Allreduce(send_view.data(), recv_view.data(), count,
                        MpiType<BT<ViewType<ViewT> > >::mpitype(), op, comm);
 }
+
+//iallreduce
+template <typename ViewT>
+IsHost<ViewSpace<ViewT> > PS_Comm_Iallreduce(ViewT send_view, ViewT recv_view, int count,
+                                             MPI_Op op, MPI_Comm comm, MPI_Request* request) {
+  return MPI_Iallreduce(send_view.data(), recv_view.data(), count,
+                        MpiType<BT<ViewType<ViewT> > >::mpitype(), op, comm, request);
+}
+
+//Alltoallv
+template <typename ViewT>
+IsHost<ViewSpace<ViewT> > PS_Comm_Alltoallv(ViewT send, const int* send_counts,
+                                            const int* send_displs,
+                                            ViewT recv, const int* recv_counts,
+                                            const int* recv_displs, MPI_Comm comm) {
+  int size_per_entry = BaseType<ViewType<ViewT> >::size;
+  Comm_Counts sc = PS_Comm_Scale_Counts(send_counts, size_per_entry, comm);
+  Comm_Counts sd = PS_Comm_Scale_Counts(send_displs, size_per_entry, comm);
+  Comm_Counts rc = PS_Comm_Scale_Counts(recv_counts, size_per_entry, comm);
+  Comm_Counts rd = PS_Comm_Scale_Counts(recv_displs, size_per_entry, comm);
+  return MPI_Alltoallv(send.data(), sc->data(), sd->data(),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                       recv.data(), rc->data(), rd->data(),
+                       MpiType<BT<ViewType<ViewT> > >::mpitype(), comm);
+}
+
+//Ialltoallv
+template <typename ViewT>
+IsHost<ViewSpace<ViewT> > PS_Comm_Ialltoallv(ViewT send, const int* send_counts,
+                                             const int* send_displs,
+                                             ViewT recv, const int* recv_counts,
+                                             const int* recv_displs, MPI_Comm comm,
+                                             MPI_Request* request) {
+  int size_per_entry = BaseType<ViewType<ViewT> >::size;
+  Comm_Counts sc = PS_Comm_Scale_Counts(send_counts, size_per_entry, comm);
+  Comm_Counts sd = PS_Comm_Scale_Counts(send_displs, size_per_entry, comm);
+  Comm_Counts rc = PS_Comm_Scale_Counts(recv_counts, size_per_entry, comm);
+  Comm_Counts rd = PS_Comm_Scale_Counts(recv_displs, size_per_entry, comm);
+  int ret = MPI_Ialltoallv(send.data(), sc->data(), sd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(),
+                           recv.data(), rc->data(), rd->data(),
+                           MpiType<BT<ViewType<ViewT> > >::mpitype(), comm, request);
+  //The count arrays must outlive the request
+  get_map()[request] = [sc, sd, rc, rd]() {};
+  return ret;
+}
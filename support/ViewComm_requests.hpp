@@ -0,0 +1,51 @@
+  /************** Request Groups **************/
+  /* A fixed capacity group of nonblocking PS_Comm requests
+
+     Requests are taken from the group with add() and passed to any of the nonblocking
+     PS_Comm functions. The group finishes the PS_Comm work of each request (copies back
+     to the device, releasing staging buffers) as it completes and then calls the
+     request's callback with the index of the request in the group. testSome() can be
+     called between kernels to progress communication without blocking.
+
+     Note: The requests are stored contiguously and never move so the group can not grow
+           past its capacity
+
+     Note: The destructor waits on any requests that are still active
+  */
+  class RequestGroup {
+  public:
+    typedef std::function<void(int)> Callback;
+
+    RequestGroup(int capacity);
+    ~RequestGroup();
+
+    //Returns a new request that calls on_complete with its index once it completes
+    MPI_Request* add(Callback on_complete = Callback());
+
+    int capacity() const {return requests.size();}
+    //Number of requests added since the group was created or reset
+    int size() const {return num_added;}
+    //Number of requests that have not completed
+    int numActive() const {return num_active;}
+
+    //Completes the requests that have finished without blocking
+    //  Returns the number of requests that completed
+    int testSome();
+    //Waits for one request to complete
+    //  Returns the index of the request or MPI_UNDEFINED if no request is active
+    int waitAny();
+    //Waits for all requests to complete
+    void waitAll();
+    //Allows the requests to be added again, all requests must be complete
+    void reset();
+  private:
+    RequestGroup(const RequestGroup&);
+    RequestGroup& operator=(const RequestGroup&);
+
+    void complete(int index);
+
+    std::vector<MPI_Request> requests;
+    std::vector<Callback> callbacks;
+    std::vector<int> indices;
+    int num_added, num_active;
+  };
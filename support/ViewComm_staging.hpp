@@ -0,0 +1,131 @@
+  /************** Staged Communication functions **************/
+  /* Messages of views that MPI can not read directly are copied through host staging
+     buffers. The buffers are pinned when CUDA is enabled and are reused from a pool
+     between messages. Messages larger than PS_Comm_Get_Chunk_Bytes() are sent in chunks
+     so the copy of one chunk to the staging buffer overlaps the transfer of the previous
+     one. The receiver posts one receive per chunk to match them and copies the message to
+     the view once every chunk has arrived.
+
+     The staged functions take any view whose entries are contiguous (rank one or
+     LayoutRight) and may also be used to stage between host memory spaces. The chunk
+     size must be the same on the sending and receiving ranks.
+  */
+
+  //How views in device memory are handed to MPI
+  enum PS_Comm_Transport {
+    PS_COMM_DIRECT, //Device pointers are passed to MPI (requires CUDA aware MPI)
+    PS_COMM_STAGED  //Data is copied through pinned host buffers
+  };
+  /* The transport defaults to direct if CUDA aware MPI was detected at compile time and
+     staged otherwise. It may be overridden by setting the PS_COMM_TRANSPORT environment
+     variable to "direct" or "staged" or by calling PS_Comm_Set_Transport.
+  */
+  void PS_Comm_Set_Transport(PS_Comm_Transport transport);
+  PS_Comm_Transport PS_Comm_Get_Transport();
+  //Largest number of bytes sent per chunk of a staged message (at most INT_MAX)
+  void PS_Comm_Set_Chunk_Bytes(std::size_t bytes);
+  std::size_t PS_Comm_Get_Chunk_Bytes();
+
+  //Runs and removes the completion function of a request if it has one
+  void PS_Comm_Complete(MPI_Request* request);
+
+#ifdef PP_USE_CUDA
+  typedef Kokkos::CudaHostPinnedSpace StagingSpace;
+#else
+  typedef Kokkos::HostSpace StagingSpace;
+#endif
+
+  //Pool of staging buffers that are reused across messages
+  class StagingPool {
+  public:
+    typedef Kokkos::View<char*, StagingSpace> Buffer;
+    StagingPool() : allocations(0), reuses(0) {}
+
+    //Returns the smallest free buffer of at least bytes or allocates a new one
+    Buffer acquire(std::size_t bytes);
+    //Returns a buffer to the pool
+    void release(Buffer buffer);
+    //Deallocates the free buffers
+    void clear();
+
+    int numAllocations() const {return allocations;}
+    int numReuses() const {return reuses;}
+    int numFree() const {return free_buffers.size();}
+  private:
+    std::vector<Buffer> free_buffers;
+    int allocations, reuses;
+  };
+  //The pool used by the staged functions, it is cleared when Kokkos is finalized
+  StagingPool& get_staging_pool();
+
+  //Number of chunks a staged message of bytes is sent in (at least one)
+  inline int PS_Comm_Num_Chunks(std::size_t bytes) {
+    const std::size_t chunk = PS_Comm_Get_Chunk_Bytes();
+    return bytes == 0 ? 1 : (bytes + chunk - 1) / chunk;
+  }
+
+  //Isend through a staging buffer
+  template <typename ViewT>
+  int PS_Comm_Isend_Staged(ViewT view, std::size_t offset, std::size_t size, int dest,
+                           int tag, MPI_Comm comm, MPI_Request* req) {
+    typedef Kokkos::View<char*, ViewSpace<ViewT>, Kokkos::MemoryUnmanaged> ByteView;
+    const std::size_t entry_bytes = BaseType<ViewType<ViewT> >::size *
+      sizeof(BT<ViewType<ViewT> >);
+    const std::size_t bytes = size * entry_bytes;
+    ByteView src(reinterpret_cast<char*>(view.data()) + offset * entry_bytes, bytes);
+    StagingPool::Buffer staging = get_staging_pool().acquire(bytes);
+
+    //Requests of every chunk except the last which completes the user's request
+    const std::size_t chunk = PS_Comm_Get_Chunk_Bytes();
+    const int nchunks = PS_Comm_Num_Chunks(bytes);
+    std::shared_ptr<std::vector<MPI_Request> > chunk_reqs(
+      new std::vector<MPI_Request>(nchunks - 1, MPI_REQUEST_NULL));
+    int ret = MPI_SUCCESS;
+    for (int c = 0; c < nchunks && ret == MPI_SUCCESS; ++c) {
+      const std::size_t begin = c * chunk;
+      const std::size_t end = std::min(bytes, begin + chunk);
+      const auto range = std::make_pair(begin, end);
+      Kokkos::deep_copy(Kokkos::subview(staging, range), Kokkos::subview(src, range));
+      MPI_Request* chunk_req = c == nchunks - 1 ? req : chunk_reqs->data() + c;
+      ret = MPI_Isend(staging.data() + begin, end - begin, MPI_CHAR, dest, tag, comm,
+                      chunk_req);
+    }
+    get_map()[req] = [staging, chunk_reqs]() {
+      MPI_Waitall(chunk_reqs->size(), chunk_reqs->data(), MPI_STATUSES_IGNORE);
+      get_staging_pool().release(staging);
+    };
+    return ret;
+  }
+
+  //Irecv through a staging buffer
+  template <typename ViewT>
+  int PS_Comm_Irecv_Staged(ViewT view, std::size_t offset, std::size_t size, int sender,
+                           int tag, MPI_Comm comm, MPI_Request* req) {
+    typedef Kokkos::View<char*, ViewSpace<ViewT>, Kokkos::MemoryUnmanaged> ByteView;
+    const std::size_t entry_bytes = BaseType<ViewType<ViewT> >::size *
+      sizeof(BT<ViewType<ViewT> >);
+    const std::size_t bytes = size * entry_bytes;
+    ByteView dst(reinterpret_cast<char*>(view.data()) + offset * entry_bytes, bytes);
+    StagingPool::Buffer staging = get_staging_pool().acquire(bytes);
+
+    const std::size_t chunk = PS_Comm_Get_Chunk_Bytes();
+    const int nchunks = PS_Comm_Num_Chunks(bytes);
+    std::shared_ptr<std::vector<MPI_Request> > chunk_reqs(
+      new std::vector<MPI_Request>(nchunks - 1, MPI_REQUEST_NULL));
+    int ret = MPI_SUCCESS;
+    for (int c = 0; c < nchunks && ret == MPI_SUCCESS; ++c) {
+      const std::size_t begin = c * chunk;
+      const std::size_t end = std::min(bytes, begin + chunk);
+      MPI_Request* chunk_req = c == nchunks - 1 ? req : chunk_reqs->data() + c;
+      ret = MPI_Irecv(staging.data() + begin, end - begin, MPI_CHAR, sender, tag, comm,
+                      chunk_req);
+    }
+    //The caller's request is the one of the last chunk, the other chunks are waited on
+    // before the message is copied
+    get_map()[req] = [dst, staging, chunk_reqs, bytes]() {
+      MPI_Waitall(chunk_reqs->size(), chunk_reqs->data(), MPI_STATUSES_IGNORE);
+      Kokkos::deep_copy(dst, Kokkos::subview(staging, std::make_pair(std::size_t(0), bytes)));
+      get_staging_pool().release(staging);
+    };
+    return ret;
+  }
@@ -13,6 +13,10 @@ template <typename Space>
 int allReduceTest(const char* name);
 template <typename Space>
 int reduceTest(const char* name);
+template <typename Space>
+int stagedSendRecvTest(const char* name, int msg_size);
+template <typename Space>
+int requestGroupTest(const char* name);
 
 template <typename Space>
 int runTests() {
@@ -26,9 +30,14 @@ int runTests() {
 
   fails += iSendRecvWaitAllTest<Space>("Isend/Irecv + Waitall");
 
+  fails += stagedSendRecvTest<Space>("Staged Isend/Irecv", 10);
+  fails += stagedSendRecvTest<Space>("Chunked staged Isend/Irecv", 10000);
+
   fails += reduceTest<Space>("Reduce");
   fails += allReduceTest<Space>("Allreduce");
 
+  fails += requestGroupTest<Space>("Request group + Iallreduce/Ialltoallv");
+
   return fails;
 }
 int main(int argc, char* argv[]) {
@@ -568,3 +577,216 @@ int allReduceTest(const char* name) {
   MPI_Allreduce(&fails, &final_fail, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
   return final_fail > 0;
 }
+
+template <typename Space>
+int stagedSendRecvTest(const char* name, int msg_size) {
+  //Setup
+  if (!comm_rank)
+    printf("Beginning Test %s_%s\n", name, Space::name());
+  int fails = 0;
+  Kokkos::View<int*, Space> device_fails("failures", 1);
+  int local_rank = comm_rank;
+  int local_size = comm_size;
+  typedef Kokkos::RangePolicy<typename Space::execution_space> ExecPolicy;
+  typename Space::execution_space exec;
+
+  //Small chunks so large messages are pipelined in many pieces
+  const std::size_t chunk_bytes = pumipic::PS_Comm_Get_Chunk_Bytes();
+  pumipic::PS_Comm_Set_Chunk_Bytes(1000);
+  pumipic::StagingPool& pool = pumipic::get_staging_pool();
+
+  //Send msg_size values of a three component type to the next rank twice, the staging
+  // buffers of the first exchange are reused by the second
+  int allocations = 0;
+  for (int iter = 0; iter < 2; ++iter) {
+    int prev_rank = (comm_rank - 1 + local_size) % local_size;
+    int next_rank = (comm_rank + 1) % local_size;
+    MPI_Request requests[2];
+    Kokkos::View<double*[3], Kokkos::LayoutRight, Space> send_view("send view", msg_size + 1);
+    Kokkos::View<double*[3], Kokkos::LayoutRight, Space> recv_view("recv view", msg_size + 1);
+    Kokkos::parallel_for(ExecPolicy(exec, 0, msg_size + 1), KOKKOS_LAMBDA(const int i) {
+      for (int j = 0; j < 3; ++j)
+        send_view(i, j) = local_rank * 3 * msg_size + i * 3 + j;
+    });
+    exec.fence();
+    int ret = pumipic::PS_Comm_Isend_Staged(send_view, 1, msg_size, next_rank, 0,
+                                            MPI_COMM_WORLD, requests);
+    if (ret != MPI_SUCCESS) {
+      fprintf(stderr, "[ERROR] Rank %d: PS_Comm_Isend_Staged to %d returned error code %d\n",
+              comm_rank, next_rank, ret);
+      ++fails;
+    }
+    ret = pumipic::PS_Comm_Irecv_Staged(recv_view, 1, msg_size, prev_rank, 0,
+                                        MPI_COMM_WORLD, requests + 1);
+    if (ret != MPI_SUCCESS) {
+      fprintf(stderr, "[ERROR] Rank %d: PS_Comm_Irecv_Staged from %d returned error code %d\n",
+              comm_rank, prev_rank, ret);
+      ++fails;
+    }
+    ret = pumipic::PS_Comm_Waitall<Space>(2, requests, MPI_STATUSES_IGNORE);
+    if (ret != MPI_SUCCESS) {
+      fprintf(stderr, "[ERROR] Rank %d: PS_Comm_Waitall returned error code %d\n",
+              comm_rank, ret);
+      ++fails;
+    }
+    Kokkos::parallel_for(ExecPolicy(exec, 1, msg_size + 1), KOKKOS_LAMBDA(const int i) {
+      for (int j = 0; j < 3; ++j) {
+        const double expected = prev_rank * 3 * msg_size + i * 3 + j;
+        if (recv_view(i, j) != expected) {
+          printf("[ERROR] Rank %d: Recevied incorrect value in element %d, %d "
+                 "[(actual) %f != %f (should be)]\n", local_rank, i, j, recv_view(i, j),
+                 expected);
+          Kokkos::atomic_add(&(device_fails(0)), 1);
+        }
+      }
+    });
+    if (iter == 0)
+      allocations = pool.numAllocations();
+    else if (pool.numAllocations() != allocations) {
+      fprintf(stderr, "[ERROR] Rank %d: Staging buffers were not reused "
+              "(%d allocations != %d)\n", comm_rank, pool.numAllocations(), allocations);
+      ++fails;
+    }
+  }
+  pumipic::PS_Comm_Set_Chunk_Bytes(chunk_bytes);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  //Closing
+  fails += pumipic::getLastValue<int>(device_fails);
+  int final_fail;
+  MPI_Allreduce(&fails, &final_fail, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  return final_fail > 0;
+}
+
+template <typename Space>
+int requestGroupTest(const char* name) {
+  //Setup
+  if (!comm_rank)
+    printf("Beginning Test %s_%s\n", name, Space::name());
+  int fails = 0;
+  Kokkos::View<int*, Space> device_fails("failures", 1);
+  int local_rank = comm_rank;
+  int local_size = comm_size;
+  typedef Kokkos::RangePolicy<typename Space::execution_space> ExecPolicy;
+  typename Space::execution_space exec;
+
+  //Ring exchange, allreduce and alltoallv progressed together by one group
+  const int msg_size = 100;
+  int prev_rank = (comm_rank - 1 + local_size) % local_size;
+  int next_rank = (comm_rank + 1) % local_size;
+  Kokkos::View<int*, Space> send_view("send_view", msg_size);
+  Kokkos::View<int*, Space> recv_view("recv_view", msg_size);
+  Kokkos::View<double*, Space> reduce_send("reduce_send", 10);
+  Kokkos::View<double*, Space> reduce_recv("reduce_recv", 10);
+  //Rank r sends r + 1 entries to every rank, each entry has two values
+  Kokkos::View<long*[2], Kokkos::LayoutRight, Space> a2a_send("a2a_send",
+                                                              (local_rank + 1) * local_size);
+  Kokkos::View<long*[2], Kokkos::LayoutRight, Space> a2a_recv("a2a_recv",
+                                                              local_size * (local_size + 1) / 2);
+  std::vector<int> send_counts(local_size), send_displs(local_size);
+  std::vector<int> recv_counts(local_size), recv_displs(local_size);
+  for (int i = 0; i < local_size; ++i) {
+    send_counts[i] = local_rank + 1;
+    send_displs[i] = i * (local_rank + 1);
+    recv_counts[i] = i + 1;
+    recv_displs[i] = i * (i + 1) / 2;
+  }
+  Kokkos::parallel_for(ExecPolicy(exec, 0, msg_size), KOKKOS_LAMBDA(const int i) {
+    send_view(i) = local_rank * msg_size + i;
+  });
+  Kokkos::parallel_for(ExecPolicy(exec, 0, 10), KOKKOS_LAMBDA(const int i) {
+    reduce_send(i) = local_rank + i;
+  });
+  Kokkos::parallel_for(ExecPolicy(exec, 0, a2a_send.extent(0)), KOKKOS_LAMBDA(const int i) {
+    const int dest = i / (local_rank + 1);
+    a2a_send(i, 0) = local_rank;
+    a2a_send(i, 1) = dest * 1000 + i % (local_rank + 1);
+  });
+  exec.fence();
+
+  std::vector<int> completed;
+  pumipic::RequestGroup group(4);
+  auto record = [&completed](int index) {completed.push_back(index);};
+  int ret = pumipic::PS_Comm_Isend(send_view, 0, msg_size, next_rank, 0, MPI_COMM_WORLD,
+                                   group.add(record));
+  ret |= pumipic::PS_Comm_Irecv(recv_view, 0, msg_size, prev_rank, 0, MPI_COMM_WORLD,
+                                group.add(record));
+  ret |= pumipic::PS_Comm_Iallreduce(reduce_send, reduce_recv, 10, MPI_SUM, MPI_COMM_WORLD,
+                                     group.add(record));
+  ret |= pumipic::PS_Comm_Ialltoallv(a2a_send, send_counts.data(), send_displs.data(),
+                                     a2a_recv, recv_counts.data(), recv_displs.data(),
+                                     MPI_COMM_WORLD, group.add(record));
+  if (ret != MPI_SUCCESS) {
+    fprintf(stderr, "[ERROR] Rank %d: Starting the grouped requests returned error code %d\n",
+            comm_rank, ret);
+    ++fails;
+  }
+  //The counts may change once the requests are started
+  std::fill(recv_counts.begin(), recv_counts.end(), 0);
+  while (group.numActive() > 0) {
+    if (group.testSome() == 0)
+      group.waitAny();
+  }
+  std::sort(completed.begin(), completed.end());
+  if (completed.size() != 4 || completed[0] != 0 || completed[3] != 3) {
+    fprintf(stderr, "[ERROR] Rank %d: Request callbacks were not called once each "
+            "(%lu calls)\n", comm_rank, completed.size());
+    ++fails;
+  }
+
+  Kokkos::parallel_for(ExecPolicy(exec, 0, msg_size), KOKKOS_LAMBDA(const int i) {
+    if (recv_view(i) != prev_rank * msg_size + i) {
+      printf("[ERROR] Rank %d: Recevied incorrect value in element %d "
+             "[(actual) %d != %d (should be)]\n", local_rank, i, recv_view(i),
+             prev_rank * msg_size + i);
+      Kokkos::atomic_add(&(device_fails(0)), 1);
+    }
+  });
+  const double TOL = .000001;
+  Kokkos::parallel_for(ExecPolicy(exec, 0, 10), KOKKOS_LAMBDA(const int i) {
+    const double sum = local_size * (local_size - 1) / 2.0 + local_size * i;
+    if (fabs(reduce_recv(i) - sum) > TOL) {
+      printf("[ERROR] Rank %d: summed value is incorrect on element %d"
+             "[(actual) %f != %f (should be)]\n", local_rank, i, reduce_recv(i), sum);
+      Kokkos::atomic_add(&(device_fails(0)), 1);
+    }
+  });
+  Kokkos::parallel_for(ExecPolicy(exec, 0, a2a_recv.extent(0)), KOKKOS_LAMBDA(const int i) {
+    //Find the sender of entry i
+    int sender = 0;
+    while ((sender + 1) * (sender + 2) / 2 <= i)
+      ++sender;
+    const long expected = local_rank * 1000 + i - sender * (sender + 1) / 2;
+    if (a2a_recv(i, 0) != sender || a2a_recv(i, 1) != expected) {
+      printf("[ERROR] Rank %d: Alltoallv entry %d is incorrect "
+             "[(actual) %ld, %ld != %d, %ld (should be)]\n", local_rank, i, a2a_recv(i, 0),
+             a2a_recv(i, 1), sender, expected);
+      Kokkos::atomic_add(&(device_fails(0)), 1);
+    }
+  });
+
+  //Requests can be reused once the group is reset
+  group.reset();
+  ret = pumipic::PS_Comm_Iallreduce(reduce_send, reduce_recv, 10, MPI_MAX, MPI_COMM_WORLD,
+                                    group.add());
+  group.waitAll();
+  if (ret != MPI_SUCCESS || group.numActive() != 0 || group.size() != 1) {
+    fprintf(stderr, "[ERROR] Rank %d: Reused request group did not complete\n", comm_rank);
+    ++fails;
+  }
+  Kokkos::parallel_for(ExecPolicy(exec, 0, 10), KOKKOS_LAMBDA(const int i) {
+    if (reduce_recv(i) != local_size - 1 + i) {
+      printf("[ERROR] Rank %d: max value is incorrect on element %d"
+             "[(actual) %f != %d (should be)]\n", local_rank, i, reduce_recv(i),
+             local_size - 1 + i);
+      Kokkos::atomic_add(&(device_fails(0)), 1);
+    }
+  });
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  //Closing
+  fails += pumipic::getLastValue<int>(device_fails);
+  int final_fail;
+  MPI_Allreduce(&fails, &final_fail, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  return final_fail > 0;
+}
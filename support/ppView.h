@@ -96,5 +96,79 @@ namespace pumipic {
     }
   };
 
+  /* Copy one entry of a view to or from a contiguous buffer of its base type
+       The components of array types are stored row-major in the buffer
+   */
+  template <class T, typename Space> struct CopyViewToBuffer {
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyViewToBuffer(BT* dst, View<T*, Space> src, int src_index) {
+      dst[0] = src(src_index);
+    }
+  };
+  template <class T, typename Space, int N> struct CopyViewToBuffer<T[N], Space> {
+    typedef T Type[N];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyViewToBuffer(BT* dst, View<Type*, Space> src, int src_index) {
+      for (int i = 0; i < N; ++i)
+        dst[i] = src(src_index, i);
+    }
+  };
+  template <class T, typename Space, int N, int M>
+  struct CopyViewToBuffer<T[N][M], Space> {
+    typedef T Type[N][M];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyViewToBuffer(BT* dst, View<Type*, Space> src, int src_index) {
+      for (int i = 0; i < N; ++i)
+        for (int j = 0; j < M; ++j)
+          dst[i * M + j] = src(src_index, i, j);
+    }
+  };
+  template <class T, typename Space, int N, int M, int P>
+  struct CopyViewToBuffer<T[N][M][P], Space> {
+    typedef T Type[N][M][P];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyViewToBuffer(BT* dst, View<Type*, Space> src, int src_index) {
+      for (int i = 0; i < N; ++i)
+        for (int j = 0; j < M; ++j)
+          for (int k = 0; k < P; ++k)
+            dst[(i * M + j) * P + k] = src(src_index, i, j, k);
+    }
+  };
+
+  template <class T, typename Space> struct CopyBufferToView {
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyBufferToView(View<T*, Space> dst, int dst_index, const BT* src) {
+      dst(dst_index) = src[0];
+    }
+  };
+  template <class T, typename Space, int N> struct CopyBufferToView<T[N], Space> {
+    typedef T Type[N];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyBufferToView(View<Type*, Space> dst, int dst_index, const BT* src) {
+      for (int i = 0; i < N; ++i)
+        dst(dst_index, i) = src[i];
+    }
+  };
+  template <class T, typename Space, int N, int M>
+  struct CopyBufferToView<T[N][M], Space> {
+    typedef T Type[N][M];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyBufferToView(View<Type*, Space> dst, int dst_index, const BT* src) {
+      for (int i = 0; i < N; ++i)
+        for (int j = 0; j < M; ++j)
+          dst(dst_index, i, j) = src[i * M + j];
+    }
+  };
+  template <class T, typename Space, int N, int M, int P>
+  struct CopyBufferToView<T[N][M][P], Space> {
+    typedef T Type[N][M][P];
+    typedef typename BaseType<T>::type BT;
+    PP_INLINE CopyBufferToView(View<Type*, Space> dst, int dst_index, const BT* src) {
+      for (int i = 0; i < N; ++i)
+        for (int j = 0; j < M; ++j)
+          for (int k = 0; k < P; ++k)
+            dst(dst_index, i, j, k) = src[(i * M + j) * P + k];
+    }
+  };
 
 }
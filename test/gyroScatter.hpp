@@ -132,10 +132,18 @@ void createGyroRingMappings(o::Mesh* mesh, o::LOs& forward_map,
   o::parallel_for(num_points, projectCoords, "projectCoords");
 
   //Use adjacency search to find the element that the projected point is in
-  o::Write<o::LO> starting_element(num_points,0, "starting_element");
+  //  The walks start from the element of the ring point, or from the first element
+  //  adjacent to the vertex if the ring point is outside of the mesh
+  typedef Kokkos::View<o::Real**, Kokkos::LayoutRight, p::device_type,
+                       Kokkos::MemoryTraits<Kokkos::Unmanaged> > RingPoints;
+  RingPoints ring_view(ring_points.data(), num_points, 2);
+  o::Write<o::LO> starting_element(num_points, -1, "starting_element");
+  p::locate_points<p::Triangle>(*mesh, o::LOs(num_points, 0, 1), ring_view,
+                                starting_element);
   auto verts2Elm = mesh->ask_up(0, mesh->dim());
   auto setInitialElement = OMEGA_H_LAMBDA(const o::LO& id) {
-    //Note: Setting initial element to be the first element adjacent to the vertex
+    if (starting_element[id] >= 0)
+      return;
     const o::LO vert_id = id / gppr / gnr;
     const auto firstElm = verts2Elm.a2ab[vert_id];
     starting_element[id] = verts2Elm.ab2b[firstElm];
@@ -21,8 +21,9 @@ namespace ps = particle_structs;
 //To demonstrate push and adjacency search we store:
 //-two fp_t[3] arrays, 'Vector3d', for the current and
 // computed (pre adjacency search) positions, and
-//-an integer to store the particles id
-typedef MemberTypes<Vector3d, Vector3d, int> Particle;
+//-an integer to store the particles id, and
+//-an integer for the search hints
+typedef MemberTypes<Vector3d, Vector3d, int, int> Particle;
 typedef ps::ParticleStructure<Particle> PS;
 
 void render(p::Mesh& picparts, int iter, int comm_rank) {
@@ -201,11 +202,15 @@ void search(p::Mesh& picparts, PS* ptcls, bool output) {
   auto x = ptcls->get<0>();
   auto xtgt = ptcls->get<1>();
   auto pid = ptcls->get<2>();
+  auto hints = ptcls->get<3>();
   o::Write<o::Real> xpoints_d(3 * psCapacity, "intersection points");
   o::Write<o::LO> xface_id(psCapacity, "intersection faces");
+  p::BoundaryCrossings crossings;
   bool isFound = p::search_mesh<Particle>(*mesh, ptcls, x, xtgt, pid, elem_ids,
-                                          xpoints_d, xface_id, maxLoops);
-  fprintf(stderr, "search_mesh (seconds) %f\n", timer.seconds());
+                                          xpoints_d, xface_id, maxLoops, &crossings,
+                                          &hints, &picparts.searchContext());
+  fprintf(stderr, "search_mesh (seconds) %f boundary crossings %d\n", timer.seconds(),
+          crossings.size());
   assert(isFound);
   //rebuild the PS to set the new element-to-particle lists
   timer.reset();
@@ -221,8 +226,10 @@ OMEGA_H_DEVICE o::Matrix<3, 4> gatherVectors(o::Reals const& a, o::Few<o::LO, 4>
 
 void setPtclIds(PS* ptcls) {
   auto pid_d = ptcls->get<2>();
+  auto hints_d = ptcls->get<3>();
   auto setIDs = PS_LAMBDA(const int& eid, const int& pid, const bool& mask) {
     pid_d(pid) = pid;
+    hints_d(pid) = 0;
   };
   ps::parallel_for(ptcls, setIDs);
 }
@@ -507,6 +514,9 @@ int main(int argc, char** argv) {
   tagParentElements(picparts, ptcls, 0);
   render(picparts,0, comm_rank);
 
+  //build the arrays the searches read before the timed steps
+  picparts.searchContext();
+
   Kokkos::Timer timer;
   Kokkos::Timer fullTimer;
   int iter;
@@ -397,14 +397,7 @@ int main(int argc, char** argv) {
   o::Mesh* mesh = picparts.mesh();
   mesh->ask_elem_verts(); //caching adjacency info
 
-  int nBuffers = picparts.numBuffers(picparts.dim());
-  int* buffered_ranks = new int[nBuffers];
-  auto buffers = picparts.bufferedRanks(picparts.dim());
-  buffered_ranks[0] = comm_rank;
-  for (int i = 0; i < nBuffers - 1; ++i)
-    buffered_ranks[i+1] = buffers[i];
-  p::Distributor<> dist(nBuffers, buffered_ranks);
-  delete [] buffered_ranks;
+  p::Distributor<> dist(picparts);
 
   //Build gyro avg mappings
   const auto rmax = 0.038;
@@ -0,0 +1,222 @@
+#include <fstream>
+
+#include <Omega_h_for.hpp>
+#include <Omega_h_file.hpp>
+#include <pumipic_mesh.hpp>
+#include <pumipic_balance.hpp>
+#include <particle_structs.hpp>
+#include <Kokkos_Core.hpp>
+
+using particle_structs::lid_t;
+using particle_structs::MemberTypes;
+using particle_structs::SellCSigma;
+namespace ps = particle_structs;
+
+//The rank each particle was created on
+typedef MemberTypes<int> Particle;
+typedef ps::ParticleStructure<Particle> PS;
+
+//Creates particles in the core elements with ten times as many on rank 0
+//  If fill_buffers is true rank 0 also fills its buffered elements
+PS* createParticles(pumipic::Mesh& picparts, bool fill_buffers = false);
+PS* createStructure(pumipic::Mesh& picparts, lid_t np, PS::kkLidView ptcls_per_elem,
+                    PS::kkLidView particle_elements, ps::MemberTypeViews particle_info);
+//Balances particles within the buffered regions and checks the reduced particle counts
+bool bufferedBalance(Omega_h::Mesh& mesh, Omega_h::LOs owner);
+//Sums the particles in each element over all picparts
+Omega_h::HostWrite<Omega_h::LO> reducedParticleCounts(pumipic::Mesh& picparts, PS* ptcls);
+
+int main(int argc, char** argv) {
+  pumipic::Library pic_lib(&argc, &argv);
+  Omega_h::Library& lib = pic_lib.omega_h_lib();
+  int rank = lib.world()->rank();
+  if (argc != 3) {
+    if (!rank)
+      fprintf(stderr, "Usage: %s <mesh> <partition filename>\n", argv[0]);
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  //**********Load the mesh in serial everywhere*************//
+  Omega_h::Mesh mesh = Omega_h::read_mesh_file(argv[1], lib.self());
+  int dim = mesh.dim();
+  int ne = mesh.nents(dim);
+
+  //********* Load the partition vector ***********//
+  Omega_h::HostWrite<Omega_h::LO> host_owners(ne);
+  std::ifstream in_str(argv[2]);
+  if (!in_str) {
+    if (!rank)
+      fprintf(stderr,"Cannot open file %s\n", argv[2]);
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+  int own;
+  int index = 0;
+  while(in_str >> own)
+    host_owners[index++] = own;
+  Omega_h::Write<Omega_h::LO> owner(host_owners);
+
+  pumipic::Mesh* picparts = new pumipic::Mesh(mesh, owner, 1, 0);
+  PS* ptcls = createParticles(*picparts);
+  long np = ptcls->nPtcls(), total_np;
+  MPI_Allreduce(&np, &total_np, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+  pumipic::ParticleBalancer balancer(mesh, 1.1);
+  const double before = balancer.imbalance(ptcls);
+  if (!rank)
+    printf("Particle imbalance before balancing %f\n", before);
+  bool success = true;
+  if (!balancer.needsBalance(ptcls)) {
+    if (!rank)
+      fprintf(stderr, "Concentrated particles were not detected as imbalanced\n");
+    success = false;
+  }
+
+  //********* Balance the picparts and the particles *********//
+  Omega_h::LOs balanced_owners = balancer.partition(*picparts, ptcls);
+  pumipic::Mesh* balanced = new pumipic::Mesh(mesh, balanced_owners, 1, 0);
+  PS::kkLidView ptcls_per_elem, particle_elements;
+  ps::MemberTypeViews particle_info;
+  lid_t np_recv = balancer.transferParticles(ptcls, *balanced, ptcls_per_elem,
+                                             particle_elements, particle_info);
+  delete ptcls;
+  delete picparts;
+  ptcls = createStructure(*balanced, np_recv, ptcls_per_elem, particle_elements,
+                          particle_info);
+  ps::destroyViews<Particle, PS::memory_space>(particle_info);
+
+  np = ptcls->nPtcls();
+  long balanced_np;
+  MPI_Allreduce(&np, &balanced_np, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (balanced_np != total_np) {
+    if (!rank)
+      fprintf(stderr, "Particles were lost in balancing (%ld != %ld)\n", balanced_np, total_np);
+    success = false;
+  }
+  const double after = balancer.imbalance(ptcls);
+  if (!rank)
+    printf("Particle imbalance after balancing %f\n", after);
+  if (after >= before) {
+    if (!rank)
+      fprintf(stderr, "Balancing did not reduce the imbalance\n");
+    success = false;
+  }
+
+  //Every particle is in a core element of its rank
+  Omega_h::LOs elm_owners = balanced->entOwners(dim);
+  Omega_h::Write<Omega_h::LO> fail(1, 0);
+  auto checkOwners = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+    if (mask && elm_owners[elm] != rank)
+      fail[0] = 1;
+  };
+  ps::parallel_for(ptcls, checkOwners, "checkOwners");
+  Omega_h::HostWrite<Omega_h::LO> fail_host(fail);
+  if (fail_host[0]) {
+    fprintf(stderr, "Particles are outside of the core on %d\n", rank);
+    success = false;
+  }
+
+  delete ptcls;
+  delete balanced;
+
+  if (!bufferedBalance(mesh, owner)) {
+    fprintf(stderr, "Buffered balancing failed on %d\n", rank);
+    success = false;
+  }
+
+  int failed = !success, total_failed;
+  MPI_Allreduce(&failed, &total_failed, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  if (!rank && !total_failed)
+    printf("All tests passed\n");
+  return total_failed ? EXIT_FAILURE : 0;
+}
+
+PS* createParticles(pumipic::Mesh& picparts, bool fill_buffers) {
+  const int rank = picparts.comm()->rank();
+  const lid_t ne = picparts.nelems();
+  const int ptcls_per_core_elem = rank == 0 ? 10 : 1;
+  const bool fill = rank == 0 && fill_buffers;
+  Omega_h::LOs elm_owners = picparts.entOwners(picparts.dim());
+  PS::kkLidView ptcls_per_elem("ptcls_per_elem", ne);
+  Omega_h::parallel_for(ne, OMEGA_H_LAMBDA(const int& i) {
+    ptcls_per_elem(i) = (fill || elm_owners[i] == rank) * ptcls_per_core_elem;
+  });
+  lid_t np = 0;
+  Kokkos::parallel_reduce("countParticles", ne, KOKKOS_LAMBDA(const int& i, lid_t& sum) {
+    sum += ptcls_per_elem(i);
+  }, np);
+  PS* ptcls = createStructure(picparts, np, ptcls_per_elem, PS::kkLidView(), NULL);
+  auto origin = ptcls->get<0>();
+  auto setOrigin = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+    if (mask)
+      origin(ptcl) = rank;
+  };
+  ps::parallel_for(ptcls, setOrigin, "setOrigin");
+  return ptcls;
+}
+
+PS* createStructure(pumipic::Mesh& picparts, lid_t np, PS::kkLidView ptcls_per_elem,
+                    PS::kkLidView particle_elements, ps::MemberTypeViews particle_info) {
+  const lid_t ne = picparts.nelems();
+  PS::kkGidView element_gids("element_gids", ne);
+  Omega_h::GOs mesh_element_gids = picparts.globalIds(picparts.dim());
+  Omega_h::parallel_for(ne, OMEGA_H_LAMBDA(const int& i) {
+    element_gids(i) = mesh_element_gids[i];
+  });
+  Kokkos::TeamPolicy<Kokkos::DefaultExecutionSpace> policy(1000, 32);
+  return new SellCSigma<Particle>(policy, INT_MAX, 1024, ne, np, ptcls_per_elem,
+                                  element_gids, particle_elements, particle_info);
+}
+
+bool bufferedBalance(Omega_h::Mesh& mesh, Omega_h::LOs owner) {
+  pumipic::Mesh picparts(mesh, owner, 2, 1);
+  const int rank = picparts.comm()->rank();
+  PS* ptcls = createParticles(picparts, true);
+  Omega_h::HostWrite<Omega_h::LO> counts_before = reducedParticleCounts(picparts, ptcls);
+  const lid_t np_before = ptcls->nPtcls();
+
+  //Particles stay in place unless the balancer reassigns them
+  PS::kkLidView new_element("new_element", ptcls->capacity());
+  PS::kkLidView new_process("new_process", ptcls->capacity());
+  auto setDestination = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+    new_element(ptcl) = mask ? elm : -1;
+    new_process(ptcl) = rank;
+  };
+  ps::parallel_for(ptcls, setDestination, "setDestination");
+  //Balance and migrate over the buffered ranks
+  ps::Distributor<> dist(picparts);
+  lid_t moved = pumipic::balanceBufferedParticles(picparts, dist, ptcls, new_element,
+                                                  new_process);
+  ptcls->migrate(new_element, new_process, dist);
+
+  bool success = true;
+  Omega_h::HostWrite<Omega_h::LO> counts_after = reducedParticleCounts(picparts, ptcls);
+  for (int i = 0; i < counts_after.size(); ++i) {
+    if (counts_after[i] != counts_before[i]) {
+      fprintf(stderr, "Reduced particle count of element %d changed on %d (%d != %d)\n",
+              i, rank, counts_after[i], counts_before[i]);
+      success = false;
+      break;
+    }
+  }
+  if (rank == 0 && picparts.comm()->size() > 1 &&
+      (moved == 0 || ptcls->nPtcls() >= np_before)) {
+    fprintf(stderr, "Rank 0 did not shed particles (%d moved)\n", moved);
+    success = false;
+  }
+  delete ptcls;
+  return success;
+}
+
+Omega_h::HostWrite<Omega_h::LO> reducedParticleCounts(pumipic::Mesh& picparts, PS* ptcls) {
+  const int dim = picparts.dim();
+  Omega_h::Write<Omega_h::LO> counts = picparts.createCommArray(dim, 1, 0);
+  auto countParticles = PS_LAMBDA(const lid_t& elm, const lid_t& ptcl, const bool& mask) {
+    if (mask)
+      Kokkos::atomic_fetch_add(&(counts[elm]), 1);
+  };
+  ps::parallel_for(ptcls, countParticles, "countParticles");
+  picparts.reduceCommArray(dim, pumipic::Mesh::SUM_OP, counts);
+  return Omega_h::HostWrite<Omega_h::LO>(counts);
+}
@@ -17,7 +17,8 @@ int main(int argc, char** argv) {
               << "Example: ./barycentric  0.0,1.0,0.0:0.5,0.0,0.0:1.0,1.0,0.0:0.5,1.0,0.5  0.5,0.6,0  0,0.3,0.3,0.4 \n"
               << "Example: ./barycentric test1\n"
               << "Example: ./barycentric test2\n"
-              << "Example: ./barycentric test3\n";
+              << "Example: ./barycentric test3\n"
+              << "Example: ./barycentric test4\n";
     exit(1);
   }
   
@@ -42,6 +43,12 @@ int main(int argc, char** argv) {
     else 
       return 1;
   }
+  else if(std::string(argv[1]) == "test4")
+  {
+    if(test_element_geometry(world)) return 0;
+    else
+      return 1;
+  }
 
   Omega_h::Real tet_h[12];
   float bcc_h[4];
@@ -0,0 +1,388 @@
+#include <Omega_h_for.hpp>
+#include <Omega_h_build.hpp>
+#include <Omega_h_array_ops.hpp>
+#include <pumipic_library.hpp>
+#include <pumipic_adjacency.hpp>
+#include <particle_structs.hpp>
+#include <Kokkos_Core.hpp>
+#include <climits>
+
+namespace o = Omega_h;
+namespace p = pumipic;
+
+typedef Kokkos::View<o::Real*[3], p::device_type> Points;
+
+//Deterministic value in [0,1) for particle i
+OMEGA_H_DEVICE o::Real hashUnit(o::LO i, o::LO salt) {
+  unsigned int h = static_cast<unsigned int>(i) * 2654435761u + salt * 40503u;
+  h ^= h >> 15;
+  h *= 2246822519u;
+  h ^= h >> 13;
+  return (h % 1000003) / 1000003.0;
+}
+
+//Unit square or cube of n elements per side of type Elm
+template <class Elm>
+o::Mesh buildBox(o::Library& lib, int n) {
+  if(Elm::dim == 2)
+    return o::build_box(lib.self(), Elm::family, 1, 1, 0, n, n, 0);
+  return o::build_box(lib.self(), Elm::family, 1, 1, 1, n, n, n);
+}
+
+/* Walks particles across a unit square or cube of elements of type Elm and checks where
+   they stop
+
+   Origins are element centroids or element vertices. Destinations are random points
+   in the box, mesh vertices, edge midpoints (which tie several exit faces) or points
+   outside of the box. Particles with destinations in the box must end in an element
+   that contains the destination. The others must leave through the boundary of the
+   box. Returns the number of particles that failed.
+ */
+template <class Elm>
+o::LO walkBox(o::Library& lib, int n, o::LO nptcls) {
+  constexpr int D = Elm::dim;
+  o::Mesh mesh = buildBox<Elm>(lib, n);
+  printf("Walking %d particles through %d %s elements\n", nptcls, mesh.nelems(),
+         Elm::name());
+
+  const auto ne = mesh.nelems();
+  const auto nv = mesh.nverts();
+  const auto nedges = mesh.nedges();
+  const auto coords = mesh.coords();
+  const auto elms2verts = mesh.ask_elem_verts();
+  const auto edges2verts = mesh.ask_verts_of(o::EDGE);
+  Points orig("orig", nptcls);
+  Points dest("dest", nptcls);
+  o::Write<o::LO> elem_ids(nptcls, "elem_ids");
+  o::Write<o::LO> outside(nptcls, "outside");
+  o::parallel_for(nptcls, OMEGA_H_LAMBDA(const o::LO& i) {
+    const o::LO elm = hashUnit(i, 1) * ne;
+    const auto elmVerts = o::gather_verts<Elm::nverts>(elms2verts, elm);
+    const auto M = o::gather_vectors<Elm::nverts,D>(coords, elmVerts);
+    auto centroid = o::zero_vector<D>();
+    for(int v=0; v<Elm::nverts; ++v)
+      centroid = centroid + M[v] / Elm::nverts;
+    for(int j=0; j<D; ++j)
+      orig(i, j) = (i % 2) ? centroid[j] : M[i % Elm::nverts][j];
+    elem_ids[i] = elm;
+    outside[i] = 0;
+    o::Vector<D> target;
+    const int kind = (i / 2) % 4;
+    if(kind == 0) {
+      for(int j=0; j<D; ++j)
+        target[j] = hashUnit(i, 2 + j);
+    }
+    else if(kind == 1) {
+      const o::LO v = hashUnit(i, 2) * nv;
+      for(int j=0; j<D; ++j)
+        target[j] = coords[v*D + j];
+    }
+    else if(kind == 2) {
+      const o::LO edge = hashUnit(i, 2) * nedges;
+      const auto a = edges2verts[edge*2];
+      const auto b = edges2verts[edge*2 + 1];
+      for(int j=0; j<D; ++j)
+        target[j] = (coords[a*D + j] + coords[b*D + j]) / 2;
+    }
+    else {
+      for(int j=0; j<D; ++j)
+        target[j] = 3 * hashUnit(i, 2 + j) - 1;
+      target[i % D] = (i % (2*D)) < D ? -0.5 : 1.5;
+      outside[i] = 1;
+    }
+    for(int j=0; j<D; ++j)
+      dest(i, j) = target[j];
+  });
+
+  o::Write<o::LO> ptcl_done(nptcls, 0, "ptcl_done");
+  o::Write<o::Real> xpoints(D*nptcls, 0, "xpoints");
+  o::Write<o::LO> xface_ids(nptcls, -1, "xface_ids");
+  o::Write<o::LO> hops(nptcls, 0, "hops");
+  Kokkos::Timer timer;
+  p::element_walk<Elm>(mesh, o::LOs(nptcls, 0, 1), orig, dest, elem_ids, ptcl_done,
+                       xpoints, xface_ids, hops, ne);
+  printf("%s walk (seconds) %f\n", Elm::name(), timer.seconds());
+
+  //Check where each particle stopped
+  const auto geom = p::element_geometry(mesh);
+  const o::Real tol = 1e-8;
+  o::Write<o::LO> failed(nptcls, 0, "failed");
+  o::parallel_for(nptcls, OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto target = p::segmentVector<D>(i, dest);
+    bool ok = ptcl_done[i];
+    if(ok && outside[i]) {
+      //left through the boundary of the box
+      ok = elem_ids[i] == -1 && xface_ids[i] >= 0;
+      bool onBoundary = false;
+      for(int j=0; j<D; ++j) {
+        const auto x = xpoints[i*D + j];
+        onBoundary = onBoundary || std::abs(x) < tol || std::abs(x - 1) < tol;
+      }
+      ok = ok && onBoundary;
+    }
+    else if(ok) {
+      const auto elm = elem_ids[i];
+      ok = elm >= 0 && p::all_positive(geom.sides<D, Elm::nsides>(elm, target), tol);
+    }
+    if(!ok) {
+      printf("ptcl %d failed: done %d elem %d face %d hops %d dest %f %f %f\n", i,
+             ptcl_done[i], elem_ids[i], xface_ids[i], hops[i], target[0], target[1],
+             D == 3 ? target[D-1] : 0.0);
+    }
+    failed[i] = !ok;
+  });
+  auto numFailed = o::get_sum(o::LOs(failed));
+
+  //Every particle that left the box is a crossing
+  const auto crossings = p::compact_crossings(o::LOs(nptcls, 0, 1), xface_ids, xpoints, D);
+  const auto numOutside = o::get_sum(o::LOs(outside));
+  if(crossings.size() != numOutside) {
+    fprintf(stderr, "%s walk recorded %d crossings for %d particles outside the box\n",
+            Elm::name(), crossings.size(), numOutside);
+    ++numFailed;
+  }
+  const auto maxHops = o::get_max(o::LOs(hops));
+  const auto totalHops = o::get_sum(o::LOs(hops));
+  printf("%s walk hops max %d average %f failures %d\n", Elm::name(), maxHops,
+         static_cast<double>(totalHops) / nptcls, numFailed);
+  return numFailed;
+}
+
+/* Locates random points in and around a unit square or cube of elements of type Elm
+   without starting elements. Points in the box must be found in an element that
+   contains them and the others must be reported outside of the mesh. Returns the number
+   of points that failed.
+ */
+template <class Elm>
+o::LO locateBox(o::Library& lib, int n, o::LO npts) {
+  constexpr int D = Elm::dim;
+  o::Mesh mesh = buildBox<Elm>(lib, n);
+  Points pos("pos", npts);
+  o::Write<o::LO> outside(npts, "outside");
+  o::parallel_for(npts, OMEGA_H_LAMBDA(const o::LO& i) {
+    //one in eight points is outside of the box
+    const o::Real scale = (i % 8) ? 1 : 2;
+    bool out = false;
+    for(int j=0; j<D; ++j) {
+      pos(i, j) = scale * hashUnit(i, 5 + j) - (scale - 1) / 2;
+      out = out || pos(i, j) < 0 || pos(i, j) > 1;
+    }
+    outside[i] = out;
+  });
+  o::Write<o::LO> elem_ids(npts, -1, "elem_ids");
+  Kokkos::Timer timer;
+  const auto numOutside = p::locate_points<Elm>(mesh, o::LOs(npts, 0, 1), pos, elem_ids);
+  printf("%s locate (seconds) %f outside %d\n", Elm::name(), timer.seconds(), numOutside);
+
+  const auto geom = p::element_geometry(mesh);
+  const o::Real tol = 1e-8;
+  o::Write<o::LO> failed(npts, 0, "failed");
+  o::parallel_for(npts, OMEGA_H_LAMBDA(const o::LO& i) {
+    const auto point = p::segmentVector<D>(i, pos);
+    const auto elm = elem_ids[i];
+    bool ok = outside[i] ? elm == -1 :
+      elm >= 0 && p::all_positive(geom.sides<D, Elm::nsides>(elm, point), tol);
+    if(!ok)
+      printf("point %d failed: elem %d pos %f %f %f\n", i, elm, point[0], point[1],
+             D == 3 ? point[D-1] : 0.0);
+    failed[i] = !ok;
+  });
+  const auto numFailed = o::get_sum(o::LOs(failed));
+  printf("%s locate failures %d\n", Elm::name(), numFailed);
+  return numFailed;
+}
+
+/* Walks particles through nwaypoints random points in a unit square or cube of elements
+   of type Elm in one call. Each waypoint must be in the element recorded for it and the
+   final element must be the element of the last waypoint. The last waypoint of one in
+   four particles is outside of the box and those particles must leave through its
+   boundary on the last segment. Returns the number of particles that failed.
+ */
+template <class Elm>
+o::LO trajectoryBox(o::Library& lib, int n, o::LO nptcls, int nwaypoints) {
+  constexpr int D = Elm::dim;
+  o::Mesh mesh = buildBox<Elm>(lib, n);
+  const auto ne = mesh.nelems();
+  const auto grid = p::element_grid(mesh);
+  Points orig("orig", nptcls);
+  Kokkos::View<o::Real**, p::device_type> waypoints("waypoints", nptcls, D * nwaypoints);
+  o::Write<o::LO> elem_ids(nptcls, "elem_ids");
+  o::parallel_for(nptcls, OMEGA_H_LAMBDA(const o::LO& i) {
+    const o::LO elm = hashUnit(i, 1) * ne;
+    for(int j=0; j<D; ++j)
+      orig(i, j) = grid.centroids[elm*D + j];
+    for(int k=0; k<nwaypoints; ++k)
+      for(int j=0; j<D; ++j)
+        waypoints(i, k*D + j) = hashUnit(i, 8 + 3*k + j);
+    if(i % 4 == 3)
+      waypoints(i, (nwaypoints-1)*D + i % D) = 1.5;
+    elem_ids[i] = elm;
+  });
+  o::Write<o::LO> ptcl_done(nptcls, 0, "ptcl_done");
+  o::Write<o::LO> waypoint_elems(nptcls * nwaypoints, -1, "waypoint_elems");
+  o::Write<o::Real> xpoints(D*nptcls, 0, "xpoints");
+  o::Write<o::LO> xface_ids(nptcls, -1, "xface_ids");
+  o::Write<o::LO> hops(nptcls, 0, "hops");
+  Kokkos::Timer timer;
+  p::trajectory_walk<Elm>(mesh, o::LOs(nptcls, 0, 1), orig, waypoints, nwaypoints,
+                          elem_ids, ptcl_done, waypoint_elems, xpoints, xface_ids,
+                          hops, ne);
+  printf("%s trajectory walk of %d waypoints (seconds) %f\n", Elm::name(), nwaypoints,
+         timer.seconds());
+
+  const auto geom = p::element_geometry(mesh);
+  const o::Real tol = 1e-8;
+  o::Write<o::LO> failed(nptcls, 0, "failed");
+  o::parallel_for(nptcls, OMEGA_H_LAMBDA(const o::LO& i) {
+    const bool leaves = i % 4 == 3;
+    bool ok = ptcl_done[i] && elem_ids[i] == waypoint_elems[i*nwaypoints + nwaypoints-1];
+    if(ok && leaves) {
+      //left through the side of the box at 1 in direction i%D
+      ok = elem_ids[i] == -1 && xface_ids[i] >= 0 &&
+           std::abs(xpoints[i*D + i % D] - 1) < tol;
+    }
+    else
+      ok = ok && xface_ids[i] == -1;
+    for(int k=0; k<nwaypoints - leaves && ok; ++k) {
+      o::Vector<D> point;
+      for(int j=0; j<D; ++j)
+        point[j] = waypoints(i, k*D + j);
+      const auto elm = waypoint_elems[i*nwaypoints + k];
+      ok = elm >= 0 && p::all_positive(geom.sides<D, Elm::nsides>(elm, point), tol);
+    }
+    if(!ok)
+      printf("ptcl %d trajectory failed: done %d elem %d face %d\n", i, ptcl_done[i],
+             elem_ids[i], xface_ids[i]);
+    failed[i] = !ok;
+  });
+  const auto numFailed = o::get_sum(o::LOs(failed));
+  printf("%s trajectory walk failures %d\n", Elm::name(), numFailed);
+  return numFailed;
+}
+
+//Position, id and search hint of a particle
+typedef ps::MemberTypes<p::Vector3d, int, int> SearchParticle;
+typedef ps::ParticleStructure<SearchParticle> SearchPS;
+
+/* Searches for the elements of particles in a particle structure on a unit square of
+   elements of type Elm that move through nwaypoints random points with
+   search_trajectory_2d. The particles start at the centroids of their elements. The
+   last waypoint of one in four particles is outside of the square. Checks the elements
+   of the waypoints, the crossings of the particles that left and the search hints.
+   Returns the number of particles that failed.
+ */
+template <class Elm>
+o::LO searchTrajectory(o::Library& lib, int n, o::LO nptcls, int nwaypoints) {
+  o::Mesh mesh = buildBox<Elm>(lib, n);
+  const auto ne = mesh.nelems();
+  const auto grid = p::element_grid(mesh);
+  SearchPS::kkLidView ptcls_per_elem("ptcls_per_elem", ne);
+  SearchPS::kkGidView element_gids("element_gids", ne);
+  o::parallel_for(ne, OMEGA_H_LAMBDA(const o::LO& e) {
+    ptcls_per_elem(e) = nptcls / ne + (e < nptcls % ne);
+    element_gids(e) = e;
+  });
+  Kokkos::TeamPolicy<p::exe_space> policy(10000, 32);
+  SearchPS* ptcls = new ps::SellCSigma<SearchParticle>(policy, INT_MAX, 32, ne, nptcls,
+                                                       ptcls_per_elem, element_gids);
+  const auto capacity = ptcls->capacity();
+  auto x = ptcls->get<0>();
+  auto pids = ptcls->get<1>();
+  auto hints = ptcls->get<2>();
+  Kokkos::View<o::Real**, p::device_type> waypoints("waypoints", capacity, 2 * nwaypoints);
+  auto setParticles = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
+    if(mask) {
+      for(int j=0; j<3; ++j)
+        x(pid, j) = j < 2 ? grid.centroids[e*2 + j] : 0;
+      pids(pid) = pid;
+      hints(pid) = 0;
+      for(int k=0; k<nwaypoints; ++k)
+        for(int j=0; j<2; ++j)
+          waypoints(pid, k*2 + j) = hashUnit(pid, 8 + 3*k + j);
+      if(pid % 4 == 3)
+        waypoints(pid, (nwaypoints-1)*2 + pid % 2) = 1.5;
+    }
+  };
+  ps::parallel_for(ptcls, setParticles);
+
+  o::Write<o::LO> elem_ids(capacity, -1, "elem_ids");
+  o::Write<o::LO> waypoint_elems(capacity * nwaypoints, -1, "waypoint_elems");
+  p::BoundaryCrossings crossings;
+  p::SegmentInt hint_seg = hints;
+  const bool found = p::search_trajectory_2d(mesh, ptcls, x, waypoints, nwaypoints, pids,
+                                             elem_ids, waypoint_elems, 0, &crossings,
+                                             &hint_seg);
+
+  const auto geom = p::element_geometry(mesh);
+  const o::Real tol = 1e-8;
+  o::Write<o::LO> failed(capacity, 0, "failed");
+  o::Write<o::LO> leaving(capacity, 0, "leaving");
+  auto checkParticles = PS_LAMBDA(const int& e, const int& pid, const int& mask) {
+    if(!mask)
+      return;
+    const bool leaves = pid % 4 == 3;
+    leaving[pid] = leaves;
+    bool ok = elem_ids[pid] == waypoint_elems[pid*nwaypoints + nwaypoints-1];
+    ok = ok && (leaves ? elem_ids[pid] == -1 && hints(pid) == 0 : hints(pid) == 1);
+    for(int k=0; k<nwaypoints - leaves && ok; ++k) {
+      o::Vector<2> point;
+      for(int j=0; j<2; ++j)
+        point[j] = waypoints(pid, k*2 + j);
+      const auto elm = waypoint_elems[pid*nwaypoints + k];
+      ok = elm >= 0 && p::all_positive(geom.sides<2, Elm::nsides>(elm, point), tol);
+    }
+    if(!ok)
+      printf("ptcl %d trajectory search failed: elem %d hint %d\n", pid, elem_ids[pid],
+             hints(pid));
+    failed[pid] = !ok;
+  };
+  ps::parallel_for(ptcls, checkParticles);
+  auto numFailed = o::get_sum(o::LOs(failed)) + !found;
+
+  //Each particle that left the square crossed the side at 1 in direction pid%2
+  const auto numLeaving = o::get_sum(o::LOs(leaving));
+  o::Write<o::LO> badCrossings(crossings.size(), 0, "bad_crossings");
+  const auto crossed = crossings.ptcls;
+  const auto faces = crossings.faces;
+  const auto xpoints = crossings.xpoints;
+  o::parallel_for(crossings.size(), OMEGA_H_LAMBDA(const o::LO& c) {
+    const auto pid = crossed[c];
+    badCrossings[c] = pid % 4 != 3 || faces[c] < 0 ||
+                      std::abs(xpoints[c*2 + pid % 2] - 1) > tol;
+  });
+  if(crossings.size() != numLeaving || o::get_sum(o::LOs(badCrossings))) {
+    fprintf(stderr, "%s trajectory search recorded %d crossings for %d particles that "
+            "left the square\n", Elm::name(), crossings.size(), numLeaving);
+    ++numFailed;
+  }
+  printf("%s trajectory search failures %d\n", Elm::name(), numFailed);
+  delete ptcls;
+  return numFailed;
+}
+
+int main(int argc, char** argv) {
+  p::Library pic_lib(&argc, &argv);
+  o::Library& lib = pic_lib.omega_h_lib();
+  const int n = argc > 1 ? atoi(argv[1]) : 6;
+  const o::LO nptcls = argc > 2 ? atoi(argv[2]) : 20000;
+  const auto numFailed = walkBox<p::Tetrahedron>(lib, n, nptcls) +
+                         walkBox<p::Hexahedron>(lib, n, nptcls) +
+                         walkBox<p::Triangle>(lib, n, nptcls) +
+                         walkBox<p::Quadrilateral>(lib, n, nptcls) +
+                         locateBox<p::Tetrahedron>(lib, n, nptcls) +
+                         locateBox<p::Hexahedron>(lib, n, nptcls) +
+                         locateBox<p::Triangle>(lib, n, nptcls) +
+                         locateBox<p::Quadrilateral>(lib, n, nptcls) +
+                         trajectoryBox<p::Tetrahedron>(lib, n, nptcls, 8) +
+                         trajectoryBox<p::Hexahedron>(lib, n, nptcls, 8) +
+                         trajectoryBox<p::Triangle>(lib, n, nptcls, 8) +
+                         trajectoryBox<p::Quadrilateral>(lib, n, nptcls, 8) +
+                         searchTrajectory<p::Triangle>(lib, n, nptcls, 8) +
+                         searchTrajectory<p::Quadrilateral>(lib, n, nptcls, 8);
+  if(numFailed) {
+    fprintf(stderr, "%d particles were not located\n", numFailed);
+    return EXIT_FAILURE;
+  }
+  printf("All tests passed\n");
+  return 0;
+}
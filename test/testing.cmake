@@ -10,6 +10,8 @@ mpi_test(barycentric_3 1 ./barycentric test1)
 
 mpi_test(barycentric_4 1 ./barycentric test2)
 
+mpi_test(barycentric_5 1 ./barycentric test4)
+
 mpi_test(linetri_intersection_2 1
   ./linetri_intersection  0.0,1.0,0.0:0.5,0.0,0.0:1.0,1.0,0.0  0.5,0.6,-2  0.5,0.6,2 )
 
@@ -34,6 +36,8 @@ mpi_test(pseudoPushAndSearch_cube_t2 1
 mpi_test(search2d 1 ./search2d
   ${TEST_DATA_DIR})
 
+mpi_test(element_walk 1 ./element_walk 6 20000)
+
 mpi_test(pseudoXGCm_scatter 1
   ./pseudoXGCm_scatter --kokkos-threads=1
   ${TEST_DATA_DIR}/plate/tri8_parDiag.osh)
@@ -77,3 +81,6 @@ mpi_test(input_construct_cube 4
 
 mpi_test(comm_array_pisces 4
          ./comm_array ${TEST_DATA_DIR}/pisces/gitr.msh testing_pisces_4.ptn)
+
+mpi_test(balance_pisces 4
+         ./balance ${TEST_DATA_DIR}/pisces/gitr.msh testing_pisces_4.ptn)